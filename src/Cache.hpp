@@ -44,6 +44,12 @@ class Cache{
                 return Value();
         }
         void add(Key key, Value value){
+            // Replace entry of same key
+            auto it = std::find_if(this->data.begin(), this->data.end(), [&key](std::pair<Key,Value>& entry){
+                return entry.first == key;
+            });
+            if(it != this->data.end())
+                this->data.erase(it);
             this->data.push_front({key, value});
             if(this->data.size() > this->max_size)
                 this->data.pop_back();
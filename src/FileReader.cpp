@@ -15,29 +15,23 @@ Permission is granted to anyone to use this software for any purpose, including
 
 #include "FileReader.hpp"
 
-std::string FileReader::dir;
-
-void FileReader::set_additional_directory(std::string dir){
-    FileReader::dir = dir;
-}
-
 #ifdef _WIN32
 
 #include "textconv.hpp"
 #include <algorithm>
 
-FileReader::FileReader(std::string& filename)
+FileReader::FileReader(std::string& filename, const std::string& dir)
 : file(CreateFileW(utf8_to_utf16(filename).c_str(), FILE_READ_DATA|STANDARD_RIGHTS_READ|SYNCHRONIZE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)){
     if(this->file == INVALID_HANDLE_VALUE){
-        std::string filenameex = FileReader::dir + filename;
+        std::string filenameex = dir + filename;
         this->file = CreateFileW(utf8_to_utf16(filenameex).c_str(), FILE_READ_DATA|STANDARD_RIGHTS_READ|SYNCHRONIZE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     }
 }
 
-FileReader::FileReader(std::wstring& filename)
+FileReader::FileReader(std::wstring& filename, const std::wstring& dir)
 : file(CreateFileW(filename.c_str(), FILE_READ_DATA|STANDARD_RIGHTS_READ|SYNCHRONIZE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)){
-    if(this->file != INVALID_HANDLE_VALUE)
-        this->file = CreateFileW((utf8_to_utf16(FileReader::dir) + filename).c_str(), FILE_READ_DATA|STANDARD_RIGHTS_READ|SYNCHRONIZE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(this->file == INVALID_HANDLE_VALUE)
+        this->file = CreateFileW((dir + filename).c_str(), FILE_READ_DATA|STANDARD_RIGHTS_READ|SYNCHRONIZE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 }
 
 FileReader::~FileReader(){
@@ -110,10 +104,10 @@ bool FileReader::getline(std::string& line){
 
 #else
 
-FileReader::FileReader(std::string& filename) : file(filename){
+FileReader::FileReader(std::string& filename, const std::string& dir) : file(filename){
     if(!file){
         file.clear();
-        file.open(FileReader::dir + filename);
+        file.open(dir + filename);
     }
 }
 
@@ -24,8 +24,6 @@ Permission is granted to anyone to use this software for any purpose, including
 
 class FileReader{
     private:
-        // Additonal directory for file searching
-        static std::string dir;
 #ifdef _WIN32
         // File handle
         HANDLE file;
@@ -36,12 +34,10 @@ class FileReader{
         std::ifstream file;
 #endif
     public:
-        // Sets an additonal search path
-        static void set_additional_directory(std::string dir);
-        // Constructors
-        FileReader(std::string& filename);
+        // Constructors (with additional search directory, f.e. of the script referencing the file)
+        FileReader(std::string& filename, const std::string& dir = std::string());
 #ifdef _WIN32
-        FileReader(std::wstring& filename);
+        FileReader(std::wstring& filename, const std::wstring& dir = std::wstring());
 #endif
         // Copy
 #ifdef _WIN32
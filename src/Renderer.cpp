@@ -27,72 +27,108 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "SSBParser.hpp"
 #include "RendererUtils.hpp"
 #include "utf8.h"
-#include "FileReader.hpp"
 
-Renderer::Renderer(int width, int height, Colorspace format, std::string& script, bool warnings)
-: width(width), height(height), format(format), ssb(SSBParser(script, warnings).data()), stencil_path_buffer(width, height, CAIRO_FORMAT_A8){
-    // Save initialization directory for later file loading
+namespace{
+    // Get script directory for later file loading (empty on failure)
+    std::string get_script_directory(std::string& script){
 #ifdef _WIN32
-    wchar_t file_path[_MAX_PATH];
-    if(_wfullpath(file_path, utf8_to_utf16(script).c_str(), _MAX_PATH)){
-        wchar_t drive[_MAX_DRIVE], dir[_MAX_DIR];
-        _wsplitpath(file_path, drive, dir, NULL, NULL); // Path, drive, directory, name, extension
-        std::wstring full_dir(drive); full_dir += dir;
-        FileReader::set_additional_directory(utf16_to_utf8(full_dir));
-    }
+        wchar_t file_path[_MAX_PATH];
+        if(_wfullpath(file_path, utf8_to_utf16(script).c_str(), _MAX_PATH)){
+            wchar_t drive[_MAX_DRIVE], dir[_MAX_DIR];
+            _wsplitpath(file_path, drive, dir, NULL, NULL); // Path, drive, directory, name, extension
+            std::wstring full_dir(drive); full_dir += dir;
+            return utf16_to_utf8(full_dir);
+        }
 #else
-    char file_path[PATH_MAX], *dir;
-    if(realpath(script.c_str(), file_path) && (dir = dirname(file_path)))
-        FileReader::set_additional_directory(std::string(dir) + '/');
+        char file_path[PATH_MAX], *dir;
+        if(realpath(script.c_str(), file_path) && (dir = dirname(file_path)))
+            return std::string(dir) + '/';
 #endif
-}
-
-Renderer::Renderer(int width, int height, Colorspace format, std::istream& script, bool warnings)
-: width(width), height(height), format(format), ssb(SSBParser(script, warnings).data()), stencil_path_buffer(width, height, CAIRO_FORMAT_A8){}
-
-void Renderer::set_target(int width, int height, Colorspace format){
-    this->width = width;
-    this->height = height;
-    this->format = format;
-    this->stencil_path_buffer = CairoImage(width, height, CAIRO_FORMAT_A8);
-    this->cache.clear();
-}
-
-void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
-                        unsigned char* dst_data, int dst_stride,
-                        SSBBlend::Mode blend_mode){
-    // Get source data
-    int src_width = cairo_image_surface_get_width(src);
-    int src_height = cairo_image_surface_get_height(src);
-    cairo_format_t src_format = cairo_image_surface_get_format(src);
-    int src_stride = cairo_image_surface_get_stride(src);
-    cairo_surface_flush(src);   // Flush pending operations on surface
-    unsigned char* src_data = cairo_image_surface_get_data(src);
-    // Anything to overlay?
-    if(dst_x < this->width && dst_y < this->height &&
-       dst_x + src_width > 0 && dst_y + src_height > 0 &&
-       src_format == CAIRO_FORMAT_ARGB32){
-        // Calculate source rectangle to overlay
-        int src_rect_x = dst_x < 0 ? -dst_x : 0,
-            src_rect_y = dst_y < 0 ? -dst_y : 0,
-            src_rect_x2 = dst_x + src_width > this->width ? this->width - dst_x : src_width,
-            src_rect_y2 = dst_y + src_height > this->height ? this->height - dst_y : src_height,
-            src_rect_width = src_rect_x2 - src_rect_x,
-            src_rect_height = src_rect_y2 - src_rect_y;
-        // Calculate destination offsets for overlay
-        int dst_offset_x = dst_x < 0 ? 0 : dst_x;
-        int dst_offset_y = this->height - 1 - (dst_y < 0 ? 0 : dst_y);
+        return std::string();
+    }
+    // Multiply 8-bit fractions of 255 (rounded like pixman, so coverage of color expands to cairo's pixels)
+    inline unsigned char mul_un8(unsigned char a, unsigned char b){
+        const unsigned int t = a * b + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+    // Expand coverage of color to ARGB32 image
+    CairoImage expand_coverage(cairo_surface_t* mask, const unsigned char* color){
+        const int width = cairo_image_surface_get_width(mask), height = cairo_image_surface_get_height(mask),
+            mask_stride = cairo_image_surface_get_stride(mask);
+        CairoImage image(width, height, CAIRO_FORMAT_ARGB32);
+        const int stride = cairo_image_surface_get_stride(image);
+        cairo_surface_flush(mask);
+        cairo_surface_flush(image);
+        const unsigned char* mask_data = cairo_image_surface_get_data(mask);
+        unsigned char* data = cairo_image_surface_get_data(image);
+        for(int y = 0; y < height; ++y){
+            const unsigned char* coverage = mask_data + y * mask_stride;
+            for(unsigned char* pixel = data + y * stride, *row_end = pixel + (width << 2); pixel != row_end; pixel += 4, ++coverage)
+                for(int channel = 0; channel < 4; ++channel)
+                    pixel[channel] = mul_un8(color[channel], *coverage);
+        }
+        cairo_surface_mark_dirty(image);
+        return image;
+    }
+    // Blend source rectangle on destination rows (destination stored bottom-up: rows go upwards)
+    void blend_pixels(const unsigned char* src_row, int src_stride, cairo_format_t src_format, const unsigned char* color,
+                      unsigned char* dst_row, int dst_stride, Renderer::Colorspace dst_format,
+                      int src_rect_width, int src_rect_height, SSBBlend::Mode blend_mode){
         // Processing data
-        int dst_pix_size = this->format == Renderer::Colorspace::BGR ? 3 : 4;
-        int src_modulo = src_stride - (src_rect_width << 2);
+        int dst_pix_size = dst_format == Renderer::Colorspace::BGR ? 3 : 4;
+        int src_pix_size = src_format == CAIRO_FORMAT_A8 ? 1 : 4;
+        int src_modulo = src_stride - (src_rect_width * src_pix_size);
         int dst_modulo = dst_stride - (src_rect_width * dst_pix_size);
-        unsigned char* src_row = src_data + src_rect_y * src_stride + (src_rect_x << 2);
-        unsigned char* dst_row = dst_data + dst_offset_y * dst_stride + (dst_offset_x * dst_pix_size);
         unsigned char inv_alpha;
+        // Coverage of color: blend over directly, expand source rectangle to ARGB32 for other modes
+        std::vector<unsigned char> src_buffer;
+        if(src_format == CAIRO_FORMAT_A8){
+            if(blend_mode == SSBBlend::Mode::OVER){
+                const bool dst_alpha = dst_format == Renderer::Colorspace::BGRA;
+                for(int src_y = 0; src_y < src_rect_height; ++src_y){
+                    for(int src_x = 0; src_x < src_rect_width; ++src_x){
+                        if(src_row[0] == 255 && color[3] == 255){
+                            dst_row[0] = color[0];
+                            dst_row[1] = color[1];
+                            dst_row[2] = color[2];
+                            if(dst_alpha)
+                                dst_row[3] = 255;
+                        }else if(src_row[0] > 0){
+                            inv_alpha = mul_un8(color[3], src_row[0]) ^ 0xFF;
+                            dst_row[0] = mul_un8(color[0], src_row[0]) + dst_row[0] * inv_alpha / 255;
+                            dst_row[1] = mul_un8(color[1], src_row[0]) + dst_row[1] * inv_alpha / 255;
+                            dst_row[2] = mul_un8(color[2], src_row[0]) + dst_row[2] * inv_alpha / 255;
+                            if(dst_alpha)
+                                dst_row[3] = mul_un8(color[3], src_row[0]) + dst_row[3] * inv_alpha / 255;
+                        }
+                        dst_row += dst_pix_size;
+                        ++src_row;
+                    }
+                    src_row += src_modulo;
+                    dst_row += -dst_stride + dst_modulo - dst_stride;
+                }
+                return;
+            }
+            src_buffer.resize(src_rect_width * src_rect_height << 2);
+            unsigned char* buffer_data = src_buffer.data();
+            for(int src_y = 0; src_y < src_rect_height; ++src_y){
+                for(int src_x = 0; src_x < src_rect_width; ++src_x){
+                    buffer_data[0] = mul_un8(color[0], src_row[0]);
+                    buffer_data[1] = mul_un8(color[1], src_row[0]);
+                    buffer_data[2] = mul_un8(color[2], src_row[0]);
+                    buffer_data[3] = mul_un8(color[3], src_row[0]);
+                    buffer_data += 4;
+                    ++src_row;
+                }
+                src_row += src_modulo;
+            }
+            src_row = src_buffer.data();
+            src_modulo = 0;
+        }
         // Overlay by blending mode (hint: source & destination have premultiplied alpha)
         switch(blend_mode){
             case SSBBlend::Mode::OVER:
-                if(this->format == Renderer::Colorspace::BGRA)
+                if(dst_format == Renderer::Colorspace::BGRA)
                     for(int src_y = 0; src_y < src_rect_height; ++src_y){
                         for(int src_x = 0; src_x < src_rect_width; ++src_x){
                             if(src_row[3] == 255){
@@ -134,7 +170,7 @@ void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
                     }
                 break;
             case SSBBlend::Mode::ADDITION:
-                if(this->format == Renderer::Colorspace::BGRA)
+                if(dst_format == Renderer::Colorspace::BGRA)
                     for(int src_y = 0; src_y < src_rect_height; ++src_y){
                         for(int src_x = 0; src_x < src_rect_width; ++src_x){
                             if(src_row[3] > 0){
@@ -166,7 +202,7 @@ void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
 
                 break;
             case SSBBlend::Mode::SUBTRACT:
-                if(this->format == Renderer::Colorspace::BGRA)
+                if(dst_format == Renderer::Colorspace::BGRA)
                     for(int src_y = 0; src_y < src_rect_height; ++src_y){
                         for(int src_x = 0; src_x < src_rect_width; ++src_x){
                             if(src_row[3] > 0){
@@ -197,7 +233,7 @@ void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
                     }
                 break;
             case SSBBlend::Mode::MULTIPLY:
-                if(this->format == Renderer::Colorspace::BGRA)
+                if(dst_format == Renderer::Colorspace::BGRA)
                     for(int src_y = 0; src_y < src_rect_height; ++src_y){
                         for(int src_x = 0; src_x < src_rect_width; ++src_x){
                             if(src_row[3] > 0){
@@ -246,7 +282,7 @@ void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
                     }
                 break;
             case SSBBlend::Mode::SCREEN:
-                if(this->format == Renderer::Colorspace::BGRA)
+                if(dst_format == Renderer::Colorspace::BGRA)
                     for(int src_y = 0; src_y < src_rect_height; ++src_y){
                         for(int src_x = 0; src_x < src_rect_width; ++src_x){
                             if(src_row[3] > 0){
@@ -295,7 +331,7 @@ void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
                     }
                 break;
             case SSBBlend::Mode::DIFFERENCES:
-                if(this->format == Renderer::Colorspace::BGRA)
+                if(dst_format == Renderer::Colorspace::BGRA)
                     for(int src_y = 0; src_y < src_rect_height; ++src_y){
                         for(int src_x = 0; src_x < src_rect_width; ++src_x){
                             if(src_row[3] > 0){
@@ -347,662 +383,1637 @@ void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
     }
 }
 
+struct Renderer::GeometryData{
+    // Geometry type
+    SSBGeometry::Type type;
+    // Render state at geometry
+    RenderState rs;
+    // Aligned & deformed path (target independent) + his extents
+    std::shared_ptr<const CairoPath> path;
+    double x1, y1, x2, y2;
+    // Aligned point centers (points geometries without deformation, for dot stamping)
+    std::shared_ptr<const std::vector<Point>> points;
+};
+
+struct Renderer::EventLayout{
+    // Laid out geometries
+    std::vector<GeometryData> geometries;
+};
+
+Renderer::Renderer(int width, int height, Colorspace format, std::string& script, bool warnings)
+: width(width), height(height), format(format), scripts({SSBParser(script, warnings).data()}){
+    // Save script directory for later file loading
+    this->script_dirs.push_back(get_script_directory(script));
+    // Decode textures in background
+    this->preloads.push_back(std::make_shared<CairoImagePreload>(get_texture_filenames(this->scripts.back()), this->script_dirs.back()));
+}
+
+Renderer::Renderer(int width, int height, Colorspace format, std::istream& script, bool warnings)
+: width(width), height(height), format(format), scripts({SSBParser(script, warnings).data()}), script_dirs(1){
+    // Decode textures in background
+    this->preloads.push_back(std::make_shared<CairoImagePreload>(get_texture_filenames(this->scripts.back()), this->script_dirs.back()));
+}
+
+void Renderer::add_script(std::string& script, bool warnings){
+    this->scripts.push_back(SSBParser(script, warnings).data());
+    clear_caches(); // Event addresses may have changed
+    // Save script directory for later file loading
+    this->script_dirs.push_back(get_script_directory(script));
+    // Decode textures in background
+    this->preloads.push_back(std::make_shared<CairoImagePreload>(get_texture_filenames(this->scripts.back()), this->script_dirs.back()));
+}
+
+void Renderer::add_script(std::istream& script, bool warnings){
+    this->scripts.push_back(SSBParser(script, warnings).data());
+    clear_caches(); // Event addresses may have changed
+    // Take directory of previous script for later file loading
+    this->script_dirs.push_back(this->script_dirs.back());
+    // Decode textures in background
+    this->preloads.push_back(std::make_shared<CairoImagePreload>(get_texture_filenames(this->scripts.back()), this->script_dirs.back()));
+}
+
+void Renderer::clear_caches(){
+    this->cache.clear();
+    this->composite_keys.clear();
+    this->composite.clear();
+    this->layout_cache.clear();
+    this->mask_cache.clear();
+    this->phase_cache.clear();
+    this->sprite_cache.clear();
+    this->karaoke_cache.clear();
+    this->raster_cache.clear();
+    this->signature_valid = false;
+}
+
+void Renderer::set_subpixel_phases(int phases){
+    this->subpixel_phases = std::max(phases, 0);
+    clear_caches();
+}
+
+void Renderer::set_dot_phases(int phases){
+    this->dot_phases = std::max(phases, 0);
+    clear_caches();
+}
+
+void Renderer::set_scanline_rasterizer(bool enable){
+    this->scanline_rasterizer = enable;
+    clear_caches();
+}
+
+void Renderer::set_frame_grid(unsigned long int fps_num, unsigned long int fps_den){
+    this->frame_grid_num = fps_num;
+    this->frame_grid_den = fps_den;
+    clear_caches();
+}
+
+void Renderer::set_target(int width, int height, Colorspace format){
+    this->width = width;
+    this->height = height;
+    this->format = format;
+    clear_caches();
+    this->dirty_rects.clear();
+}
+
+const std::vector<Renderer::Rect>& Renderer::get_dirty_rects() const{
+    return this->dirty_rects;
+}
+
+unsigned long long int Renderer::get_signature(bool* changed) const{
+    if(changed)
+        *changed = this->signature_changed;
+    return this->signature;
+}
+
+Renderer::Stats Renderer::get_stats() const{
+    Renderer::Stats stats = this->stats;
+    const CairoImage::FileStats texture_stats = CairoImage::get_file_stats();
+    stats.texture_lookups = texture_stats.lookups,
+    stats.texture_hits = texture_stats.hits,
+    stats.texture_decodes = texture_stats.decodes,
+    stats.texture_decode_ms = texture_stats.decode_ms;
+    return stats;
+}
+
+void Renderer::blend(cairo_surface_t* src, int dst_x, int dst_y,
+                        const Renderer::Target& target, const Renderer::Rect& region,
+                        SSBBlend::Mode blend_mode, bool feedback, const unsigned char* color){
+    // Get source data
+    int src_width = cairo_image_surface_get_width(src);
+    int src_height = cairo_image_surface_get_height(src);
+    cairo_format_t src_format = cairo_image_surface_get_format(src);
+    int src_stride = cairo_image_surface_get_stride(src);
+    cairo_surface_flush(src);   // Flush pending operations on surface
+    unsigned char* src_data = cairo_image_surface_get_data(src);
+    // Anything to overlay (in render region)?
+    const int region_x2 = region.x + region.width,
+        region_y2 = region.y + region.height;
+    if(dst_x < region_x2 && dst_y < region_y2 &&
+       dst_x + src_width > region.x && dst_y + src_height > region.y &&
+       src_width > 0 && src_height > 0 &&
+       (src_format == CAIRO_FORMAT_ARGB32 || (src_format == CAIRO_FORMAT_A8 && color))){
+        // Calculate source rectangle to overlay
+        int src_rect_x = dst_x < region.x ? region.x - dst_x : 0,
+            src_rect_y = dst_y < region.y ? region.y - dst_y : 0,
+            src_rect_x2 = dst_x + src_width > region_x2 ? region_x2 - dst_x : src_width,
+            src_rect_y2 = dst_y + src_height > region_y2 ? region_y2 - dst_y : src_height,
+            src_rect_width = src_rect_x2 - src_rect_x,
+            src_rect_height = src_rect_y2 - src_rect_y;
+        // Save modified frame area
+        if(feedback)
+            this->dirty_rects.push_back({dst_x + src_rect_x, dst_y + src_rect_y, src_rect_width, src_rect_height});
+        // Calculate destination offsets for overlay (destination frame = render region, stored bottom-up)
+        int dst_offset_x = dst_x + src_rect_x - region.x;
+        int dst_offset_y = region.height - 1 - (dst_y + src_rect_y - region.y);
+        // Overlay source rectangle
+        blend_pixels(src_data + src_rect_y * src_stride + src_rect_x * (src_format == CAIRO_FORMAT_A8 ? 1 : 4), src_stride, src_format, color,
+                     target.frame + dst_offset_y * target.pitch + dst_offset_x * (target.format == Renderer::Colorspace::BGR ? 3 : 4), target.pitch, target.format,
+                     src_rect_width, src_rect_height, blend_mode);
+    }
+}
+
+void Renderer::blend(const Renderer::SpanData& src, int dst_x, int dst_y,
+                        const Renderer::Target& target, const Renderer::Rect& region,
+                        SSBBlend::Mode blend_mode, bool feedback, const unsigned char* color){
+    // Anything to overlay (in render region)?
+    const int region_x2 = region.x + region.width,
+        region_y2 = region.y + region.height;
+    if(dst_x < region_x2 && dst_y < region_y2 &&
+       dst_x + src.width > region.x && dst_y + src.height > region.y &&
+       src.width > 0 && src.height > 0 &&
+       (src.format == CAIRO_FORMAT_ARGB32 || (src.format == CAIRO_FORMAT_A8 && color))){
+        // Save modified frame area
+        if(feedback){
+            const int rect_x = std::max(dst_x, region.x),
+                rect_y = std::max(dst_y, region.y);
+            this->dirty_rects.push_back({rect_x, rect_y, std::min(dst_x + src.width, region_x2) - rect_x, std::min(dst_y + src.height, region_y2) - rect_y});
+        }
+        // Overlay runs in render region (empty space gets skipped)
+        const int src_pix_size = src.format == CAIRO_FORMAT_A8 ? 1 : 4,
+            dst_pix_size = target.format == Renderer::Colorspace::BGR ? 3 : 4;
+        for(const Renderer::Span& span : src.spans){
+            const int y = dst_y + span.y,
+                x = std::max(dst_x + span.x, region.x),
+                x2 = std::min(dst_x + span.x + span.width, region_x2);
+            if(y < region.y || y >= region_y2 || x >= x2)
+                continue;
+            const unsigned char* src_row = src.pixels.data() + span.offset + (x - dst_x - span.x) * src_pix_size;
+            unsigned char* dst_row = target.frame + (region.height - 1 - (y - region.y)) * target.pitch + (x - region.x) * dst_pix_size;
+            // Copy opaque runs blended over, blend others
+            if(span.opaque && blend_mode == SSBBlend::Mode::OVER && (src.format == CAIRO_FORMAT_ARGB32 || color[3] == 255)){
+                const unsigned char* pixel = src.format == CAIRO_FORMAT_A8 ? color : src_row;
+                for(unsigned char* dst_row_end = dst_row + (x2 - x) * dst_pix_size; dst_row != dst_row_end; dst_row += dst_pix_size){
+                    dst_row[0] = pixel[0];
+                    dst_row[1] = pixel[1];
+                    dst_row[2] = pixel[2];
+                    if(target.format == Renderer::Colorspace::BGRA)
+                        dst_row[3] = 255;
+                    if(src.format == CAIRO_FORMAT_ARGB32)
+                        pixel += 4;
+                }
+            }else
+                blend_pixels(src_row, (x2 - x) * src_pix_size, src.format, color,
+                             dst_row, target.pitch, target.format,
+                             x2 - x, 1, blend_mode);
+        }
+    }
+}
+
+void Renderer::blend(SSBEvent& event, Renderer::ImageData& idata, unsigned long int start_ms,
+                     const Renderer::Target& target, const Renderer::Rect& region, bool feedback){
+    const double fade_alpha = get_fade_alpha(idata.fade_in, idata.fade_out, start_ms, event.start_ms, event.end_ms);
+    const bool coverage = idata.spans ? idata.spans->format == CAIRO_FORMAT_A8 : cairo_image_surface_get_format(idata.image) == CAIRO_FORMAT_A8;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+    if(fade_alpha == 1){
+#pragma GCC diagnostic pop
+        if(idata.spans)
+            this->blend(*idata.spans, idata.x, idata.y, target, region, idata.blend_mode, feedback, coverage ? idata.color : nullptr);
+        else
+            this->blend(idata.image, idata.x, idata.y, target, region, idata.blend_mode, feedback, coverage ? idata.color : nullptr);
+    }else{
+        // Fade pixels (coverage expanded to colored pixels first, so faded results equal uncompacted ones)
+        CairoImage image = this->decode_spans(idata);
+        if(coverage)
+            image = expand_coverage(image, idata.color);
+        this->blend(create_faded_image(image, idata.fade_in, idata.fade_out, start_ms, event.start_ms, event.end_ms),
+                    idata.x, idata.y, target, region, idata.blend_mode, feedback);
+    }
+}
+
 void Renderer::render(unsigned char* frame, int pitch, unsigned long int start_ms) noexcept{
-    // Iterate through SSB events
-    for(SSBEvent& event : this->ssb.events)
+    this->render_region(frame, pitch, start_ms, 0, 0, this->width, this->height);
+}
+
+void Renderer::render_region(unsigned char* frame, int pitch, unsigned long int start_ms, int x, int y, int width, int height) noexcept{
+    // Set render region (limited to frame)
+    Renderer::Rect region;
+    region.x = std::max(x, 0);
+    region.y = std::max(y, 0);
+    region.width = std::min(x + width, this->width) - region.x;
+    region.height = std::min(y + height, this->height) - region.y;
+    // Render on frame as single target
+    Renderer::Target target = {frame, pitch, this->width, this->height, this->format};
+    this->render_targets(&target, &region, 1, start_ms);
+}
+
+void Renderer::render_multi(const std::vector<Target>& targets, unsigned long int start_ms) noexcept{
+    // Render regions are full target frames
+    std::vector<Renderer::Rect> regions;
+    for(const Renderer::Target& target : targets)
+        regions.push_back({0, 0, target.width, target.height});
+    if(!targets.empty())
+        this->render_targets(targets.data(), regions.data(), targets.size(), start_ms);
+}
+
+void Renderer::sign(SSBEvent& event, bool cacheable, long int segment, const std::vector<Renderer::ImageData>& event_images, unsigned long int start_ms){
+    // Add event state to signature (event images are constant in cacheable time segments, fades + other events change by time)
+    hash_value(this->signature, &event);
+    if(cacheable && std::all_of(event_images.begin(), event_images.end(), [&event,&start_ms](const Renderer::ImageData& idata){
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+        return get_fade_alpha(idata.fade_in, idata.fade_out, start_ms, event.start_ms, event.end_ms) == 1;
+#pragma GCC diagnostic pop
+    }))
+        hash_value(this->signature, segment);
+    else
+        hash_value(this->signature, start_ms);
+}
+
+void Renderer::compact(Renderer::ImageData& idata){
+    // Get source data
+    cairo_surface_t* image = idata.image;
+    if(cairo_image_surface_get_format(image) != CAIRO_FORMAT_ARGB32)
+        return;
+    int width = cairo_image_surface_get_width(image),
+        height = cairo_image_surface_get_height(image),
+        stride = cairo_image_surface_get_stride(image);
+    cairo_surface_flush(image);
+    const unsigned char* data = cairo_image_surface_get_data(image);
+    // Find color at highest coverage
+    unsigned char color[4] = {0, 0, 0, 0};
+    for(int y = 0; y < height; ++y)
+        for(const unsigned char* pixel = data + y * stride, *row_end = pixel + (width << 2); pixel != row_end; pixel += 4)
+            if(pixel[3] > color[3])
+                std::copy(pixel, pixel + 4, color);
+    // Calculate coverage of color (abort on pixels not expanding exactly from coverage)
+    CairoImage mask(width, height, CAIRO_FORMAT_A8);
+    int mask_stride = cairo_image_surface_get_stride(mask);
+    cairo_surface_flush(mask);
+    unsigned char* mask_data = cairo_image_surface_get_data(mask);
+    for(int y = 0; y < height; ++y){
+        const unsigned char* pixel = data + y * stride;
+        unsigned char* coverage = mask_data + y * mask_stride;
+        for(int x = 0; x < width; ++x){
+            if(pixel[3] > 0){
+                // Search coverages expanding to pixel alpha (around estimation) for one matching the colors too
+                int cov = std::min((pixel[3] * 255 + (color[3] >> 1)) / color[3], 255);
+                while(cov > 0 && mul_un8(color[3], cov - 1) >= pixel[3])
+                    --cov;
+                while(cov < 255 && mul_un8(color[3], cov) < pixel[3])
+                    ++cov;
+                while(cov <= 255 && mul_un8(color[3], cov) == pixel[3] &&
+                      (mul_un8(color[0], cov) != pixel[0] || mul_un8(color[1], cov) != pixel[1] || mul_un8(color[2], cov) != pixel[2]))
+                    ++cov;
+                if(cov > 255 || mul_un8(color[3], cov) != pixel[3])
+                    return;
+                *coverage = cov;
+            }else if(pixel[0] || pixel[1] || pixel[2])
+                return;
+            pixel += 4;
+            ++coverage;
+        }
+    }
+    cairo_surface_mark_dirty(mask);
+    // Replace image
+    idata.image = mask;
+    std::copy(color, color + 4, idata.color);
+}
+
+void Renderer::encode_spans(Renderer::ImageData& idata){
+    // Get source data
+    cairo_surface_t* image = idata.image;
+    cairo_format_t format = cairo_image_surface_get_format(image);
+    if(idata.spans || (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_A8))
+        return;
+    std::shared_ptr<Renderer::SpanData> span_data(new Renderer::SpanData{cairo_image_surface_get_width(image), cairo_image_surface_get_height(image), format, {}, {}});
+    int stride = cairo_image_surface_get_stride(image),
+        pix_size = format == CAIRO_FORMAT_A8 ? 1 : 4;
+    cairo_surface_flush(image);
+    const unsigned char* data = cairo_image_surface_get_data(image);
+    // Collect runs of empty, opaque & partial pixels
+    for(int y = 0; y < span_data->height; ++y){
+        const unsigned char* row = data + y * stride;
+        for(int x = 0; x < span_data->width;){
+            const unsigned char alpha = row[x * pix_size + pix_size - 1];
+            int x2 = x + 1;
+            if(alpha == 0){
+                while(x2 < span_data->width && row[x2 * pix_size + pix_size - 1] == 0)
+                    ++x2;
+            }else{
+                while(x2 < span_data->width && (row[x2 * pix_size + pix_size - 1] == 255) == (alpha == 255) && row[x2 * pix_size + pix_size - 1] != 0)
+                    ++x2;
+                span_data->spans.push_back({x, y, x2 - x, alpha == 255, span_data->pixels.size()});
+                span_data->pixels.insert(span_data->pixels.end(), row + x * pix_size, row + x2 * pix_size);
+            }
+            x = x2;
+        }
+    }
+    // Replace image by smaller runs
+    if(span_data->pixels.size() + span_data->spans.size() * sizeof(Renderer::Span) < static_cast<size_t>(stride * span_data->height)){
+        span_data->spans.shrink_to_fit();
+        span_data->pixels.shrink_to_fit();
+        idata.spans = span_data;
+        idata.image = CairoImage();
+    }
+}
+
+CairoImage Renderer::decode_spans(const Renderer::ImageData& idata){
+    if(!idata.spans)
+        return idata.image;
+    // Write runs into empty image
+    CairoImage image(idata.spans->width, idata.spans->height, idata.spans->format);
+    int stride = cairo_image_surface_get_stride(image),
+        pix_size = idata.spans->format == CAIRO_FORMAT_A8 ? 1 : 4;
+    cairo_surface_flush(image);
+    unsigned char* data = cairo_image_surface_get_data(image);
+    for(const Renderer::Span& span : idata.spans->spans)
+        std::copy(idata.spans->pixels.begin() + span.offset, idata.spans->pixels.begin() + span.offset + span.width * pix_size, data + span.y * stride + span.x * pix_size);
+    cairo_surface_mark_dirty(image);
+    return image;
+}
+
+std::vector<Renderer::ImageData> Renderer::flatten(const std::vector<Renderer::ImageData>& images){
+    // Get image data (decoded from pixel runs)
+    std::vector<CairoImage> sources;
+    for(const Renderer::ImageData& idata : images)
+        sources.push_back(this->decode_spans(idata));
+    // Group images by overlapping areas
+    std::vector<Renderer::Rect> rects;
+    std::vector<std::vector<size_t>> members;
+    for(size_t image_i = 0; image_i < images.size(); ++image_i){
+        Renderer::Rect rect = {images[image_i].x, images[image_i].y, cairo_image_surface_get_width(sources[image_i]), cairo_image_surface_get_height(sources[image_i])};
+        if(rect.width <= 0 || rect.height <= 0)
+            continue;
+        std::vector<size_t> rect_members = {image_i};
+        for(size_t rect_i = 0; rect_i < rects.size();)
+            if(rects[rect_i].x < rect.x + rect.width && rects[rect_i].y < rect.y + rect.height &&
+               rects[rect_i].x + rects[rect_i].width > rect.x && rects[rect_i].y + rects[rect_i].height > rect.y){
+                const int x2 = std::max(rect.x + rect.width, rects[rect_i].x + rects[rect_i].width),
+                    y2 = std::max(rect.y + rect.height, rects[rect_i].y + rects[rect_i].height);
+                rect.x = std::min(rect.x, rects[rect_i].x),
+                rect.y = std::min(rect.y, rects[rect_i].y),
+                rect.width = x2 - rect.x,
+                rect.height = y2 - rect.y;
+                rect_members.insert(rect_members.end(), members[rect_i].begin(), members[rect_i].end());
+                rects.erase(rects.begin() + rect_i);
+                members.erase(members.begin() + rect_i);
+                rect_i = 0; // Grown area could overlap already checked ones
+            }else
+                ++rect_i;
+        rects.push_back(rect);
+        members.push_back(rect_members);
+    }
+    // Composite images of groups in stacking order (by frame blending arithmetic, so pixels of single images stay exact)
+    std::vector<Renderer::ImageData> flat_images;
+    for(size_t rect_i = 0; rect_i < rects.size(); ++rect_i){
+        std::sort(members[rect_i].begin(), members[rect_i].end());
+        CairoImage image(rects[rect_i].width, rects[rect_i].height, CAIRO_FORMAT_ARGB32);
+        const int stride = cairo_image_surface_get_stride(image);
+        cairo_surface_flush(image);
+        unsigned char* data = cairo_image_surface_get_data(image);
+        bool exact = members[rect_i].size() > 1;
+        for(size_t image_i : members[rect_i]){
+            const Renderer::ImageData& idata = images[image_i];
+            cairo_surface_t* source = sources[image_i];
+            const cairo_format_t format = cairo_image_surface_get_format(source);
+            if(!exact)
+                break;
+            if(format == CAIRO_FORMAT_ARGB32 || (format == CAIRO_FORMAT_A8 && idata.color[3] > 0)){
+                cairo_surface_flush(source);
+                const unsigned char* src_data = cairo_image_surface_get_data(source);
+                const int src_width = cairo_image_surface_get_width(source), src_height = cairo_image_surface_get_height(source),
+                    src_stride = cairo_image_surface_get_stride(source);
+                unsigned char* dst_data = data + (idata.y - rects[rect_i].y) * stride + ((idata.x - rects[rect_i].x) << 2);
+                // Partial pixels over composited ones would differ from blending on frame (8-bit blending isn't associative)
+                for(int y = 0; y < src_height && exact; ++y)
+                    for(int x = 0; x < src_width; ++x){
+                        const unsigned char alpha = format == CAIRO_FORMAT_A8 ? mul_un8(idata.color[3], src_data[y * src_stride + x]) : src_data[y * src_stride + (x << 2) + 3];
+                        if(alpha > 0 && alpha < 255 && dst_data[y * stride + (x << 2) + 3] > 0){
+                            exact = false;
+                            break;
+                        }
+                    }
+                // Image rows go downwards (negative stride for bottom-up blending)
+                if(exact)
+                    blend_pixels(src_data, src_stride, format, idata.color,
+                                 dst_data, -stride, Renderer::Colorspace::BGRA,
+                                 src_width, src_height, SSBBlend::Mode::OVER);
+            }
+        }
+        // Keep images of single or inexact groups apart
+        if(!exact)
+            for(size_t image_i : members[rect_i]){
+                Renderer::ImageData idata = images[image_i];
+                this->compact(idata);
+                this->encode_spans(idata);
+                flat_images.push_back(idata);
+            }
+        else{
+            cairo_surface_mark_dirty(image);
+            Renderer::ImageData flat_image = {image, rects[rect_i].x, rects[rect_i].y, SSBBlend::Mode::OVER, 0, 0, {0, 0, 0, 0}, nullptr};
+            this->compact(flat_image);
+            this->encode_spans(flat_image);
+            flat_images.push_back(flat_image);
+        }
+    }
+    return flat_images;
+}
+
+void Renderer::render_targets(const Renderer::Target* targets, const Renderer::Rect* regions, size_t targets_n, unsigned long int start_ms){
+    // Quantize time to frame grid (floor to frame starting in the millisecond, hosts pass truncated frame times)
+    long int frame_index = -1;
+    if(this->frame_grid_num > 0 && this->frame_grid_den > 0){
+        const unsigned long long int ms_den = this->frame_grid_den * 1000ULL;
+        frame_index = ((start_ms + 1ULL) * this->frame_grid_num - 1) / ms_den;
+        start_ms = frame_index * ms_den / this->frame_grid_num;
+    }
+    // Reset render feedback (refers to first target)
+    this->dirty_rects.clear();
+    const unsigned long long int last_signature = this->signature;
+    this->signature = 14695981039346656037ULL;  // FNV offset basis
+    hash_value(this->signature, targets[0].width);
+    hash_value(this->signature, targets[0].height);
+    hash_value(this->signature, regions[0]);
+    // Event images are cacheable in time segments with constant state or per frame on grid
+    auto get_segment = [&start_ms,&frame_index](SSBEvent& event, long int& segment) -> bool{
+        if(get_time_segment(event, start_ms - event.start_ms, event.end_ms - event.start_ms, segment))
+            return true;
+        segment = -1 - frame_index;
+        return frame_index >= 0;
+    };
+    // Collect cache keys of active set on first target (full frame, every event cached, unfaded & blended over)
+    std::vector<Renderer::CacheKey> composite_keys;
+    bool use_composite = regions[0].x == 0 && regions[0].y == 0 && regions[0].width == targets[0].width && regions[0].height == targets[0].height;
+    for(SSBData& ssb : this->scripts)
+        for(SSBEvent& event : ssb.events)
+            if(use_composite && start_ms >= event.start_ms && start_ms < event.end_ms){
+                long int segment;
+                const bool cacheable = get_segment(event, segment);
+                const Renderer::CacheKey key = {&event, targets[0].width, targets[0].height, segment};
+                composite_keys.push_back(key);
+                if(!cacheable || !this->cache.contains(key))
+                    use_composite = false;
+                else
+                    for(Renderer::ImageData& idata : this->cache.get(key))
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+                        if(idata.blend_mode != SSBBlend::Mode::OVER || get_fade_alpha(idata.fade_in, idata.fade_out, start_ms, event.start_ms, event.end_ms) != 1)
+#pragma GCC diagnostic pop
+                            use_composite = false;
+            }
+    // Draw composite of unchanged active set on first target
+    use_composite = use_composite && !composite_keys.empty() && composite_keys == this->composite_keys;
+    if(use_composite){
+        // Flatten event images
+        if(this->composite.empty()){
+            std::vector<Renderer::ImageData> images;
+            for(Renderer::CacheKey& key : composite_keys){
+                std::vector<Renderer::ImageData> event_images = this->cache.get(key);
+                images.insert(images.end(), event_images.begin(), event_images.end());
+            }
+            this->composite = this->flatten(images);
+        }
+        for(Renderer::ImageData& idata : this->composite)
+            if(idata.spans)
+                this->blend(*idata.spans, idata.x, idata.y, targets[0], regions[0], idata.blend_mode, true, idata.color);
+            else
+                this->blend(idata.image, idata.x, idata.y, targets[0], regions[0], idata.blend_mode, true, idata.color);
+        // Sign events like separated drawing
+        for(Renderer::CacheKey& key : composite_keys)
+            this->sign(*key.event, true, key.segment, this->cache.get(key), start_ms);
+    }else{
+        // Remember active set for next render (composite gets flattened on repetition)
+        this->composite_keys = composite_keys;
+        this->composite.clear();
+    }
+    // Iterate through SSB events (scripts in stacking order)
+    for(SSBData& ssb : this->scripts)
+        for(SSBEvent& event : ssb.events)
         // Process active SSB event
         if(start_ms >= event.start_ms && start_ms < event.end_ms){
-            // Draw from cache
-            if(this->cache.contains(&event))
-                for(Renderer::ImageData& idata : this->cache.get(&event))
-                    this->blend(create_faded_image(idata.image, idata.fade_in, idata.fade_out, start_ms, event.start_ms, event.end_ms),
-                                idata.x, idata.y, frame, pitch, idata.blend_mode);
-            // Draw new
-            else{
-                // Buffer for cache entry
+            // Event layouts by layout frame size (shared by all targets with same size or by all targets on script frame)
+            struct Layout{
+                int width, height;
+                std::shared_ptr<Renderer::EventLayout> data;
+            };
+            std::vector<Layout> layouts;
+            // Event images are cacheable in time segments with constant state or per frame on grid
+            long int segment;
+            const bool cacheable = get_segment(event, segment);
+            // Iterate through targets
+            for(size_t i = 0; i < targets_n; ++i){
+                const Renderer::Target& target = targets[i];
+                const Renderer::Rect& region = regions[i];
+                const bool feedback = i == 0;
+                // Anything to render (not drawn by composite)?
+                if(region.width <= 0 || region.height <= 0 || (feedback && use_composite))
+                    continue;
+                // Get event images from cache
+                const Renderer::CacheKey key = {&event, target.width, target.height, segment};
                 std::vector<Renderer::ImageData> event_images;
-                // Stencil entry mode (on change: stencil was modified)
-                cairo_set_operator(this->stencil_path_buffer, CAIRO_OPERATOR_SOURCE);
-                // Calculate image-to-video scale
-                double frame_scale_x, frame_scale_y;
-                if(this->ssb.frame.width > 0 && this->ssb.frame.height > 0)
-                    frame_scale_x = static_cast<double>(this->width) / this->ssb.frame.width, frame_scale_y = static_cast<double>(this->height) / this->ssb.frame.height;
-                else
-                    frame_scale_x = frame_scale_y = 0;
-                // Create render state for rendering behaviour
-                RenderState rs;
-                // Collect render sizes (position groups -> lines -> geometry positions)
-                std::vector<PosSize> render_sizes = {{}};
-                for(std::shared_ptr<SSBObject>& obj : event.objects)
-                    if(obj->type == SSBObject::Type::TAG){
-                        if(rs.eval_tag(dynamic_cast<SSBTag*>(obj.get()), start_ms - event.start_ms, event.end_ms - event.start_ms).position)
-                            render_sizes.push_back({});
-                    }else{  // obj->type == SSBObject::Type::GEOMETRY
-                        // Calculate wrap limits
-                        double wrap_width, wrap_height;
+                if(cacheable && this->cache.contains(key))
+                    event_images = this->cache.get(key);
+                // Create new event images
+                else{
+                    // Get layout for frame size (script frame or target frame)
+                    int layout_width, layout_height;
+                    if(ssb.frame.width > 0 && ssb.frame.height > 0)
+                        layout_width = ssb.frame.width, layout_height = ssb.frame.height;
+                    else
+                        layout_width = target.width, layout_height = target.height;
+                    auto layout = std::find_if(layouts.begin(), layouts.end(), [&layout_width,&layout_height](Layout& layout){
+                        return layout.width == layout_width && layout.height == layout_height;
+                    });
+                    if(layout == layouts.end()){
+                        layouts.push_back({layout_width, layout_height, this->layout_event(event, start_ms, layout_width, layout_height)});
+                        layout = layouts.end() - 1;
+                    }
+                    // Draw layout for target
+                    this->draw_event(event, ssb.frame, this->script_dirs[&ssb - this->scripts.data()], layout->data->geometries, start_ms, target, region, event_images);
+                    // Flatten unfaded images blended over into one bitmap (one blending pass per event), compact others
+                    // Region renderings too, so every rendering blends by the same pixel math as cached images
+                    if(event_images.size() > 1 &&
+                       std::all_of(event_images.begin(), event_images.end(), [](Renderer::ImageData& idata){
+                           return idata.blend_mode == SSBBlend::Mode::OVER && idata.fade_in <= 0 && idata.fade_out <= 0;
+                       }))
+                        event_images = this->flatten(event_images);
+                    else
+                        for(Renderer::ImageData& idata : event_images)
+                            this->compact(idata),
+                            this->encode_spans(idata);
+                    // Save event images to cache (region images are clipped, so just full frame renderings are cacheable)
+                    if(cacheable && region.x == 0 && region.y == 0 && region.width == target.width && region.height == target.height && !event_images.empty())
+                        this->cache.add(key, event_images);
+                }
+                // Blend event images on target
+                for(Renderer::ImageData& idata : event_images)
+                    this->blend(event, idata, start_ms, target, region, feedback);
+                if(feedback)
+                    this->sign(event, cacheable, segment, event_images, start_ms);
+            }
+        }
+    // Compare signature with previous render
+    this->signature_changed = !this->signature_valid || this->signature != last_signature;
+    this->signature_valid = true;
+}
+
+std::shared_ptr<Renderer::EventLayout> Renderer::layout_event(SSBEvent& event, unsigned long int start_ms, int frame_width, int frame_height){
+    // Create render state for rendering behaviour
+    RenderState rs;
+    // Collect geometry render states + identity of layout-affecting state
+    std::vector<RenderState> states;
+    unsigned long long int state_hash = 14695981039346656037ULL;  // FNV offset basis
+    for(std::shared_ptr<SSBObject>& obj : event.objects)
+        if(obj->type == SSBObject::Type::TAG){
+            if(rs.eval_tag(dynamic_cast<SSBTag*>(obj.get()), start_ms - event.start_ms, event.end_ms - event.start_ms).position)
+                hash_value(state_hash, states.size()); // Position group break
+        }else{  // obj->type == SSBObject::Type::GEOMETRY
+            SSBGeometry::Type type = dynamic_cast<SSBGeometry*>(obj.get())->type;
+            hash_value(state_hash, type);
+            hash_data(state_hash, rs.font_family.data(), rs.font_family.size());
+            hash_value(state_hash, rs.bold);
+            hash_value(state_hash, rs.italic);
+            hash_value(state_hash, rs.underline);
+            hash_value(state_hash, rs.strikeout);
+            hash_value(state_hash, rs.font_size);
+            hash_value(state_hash, rs.font_space_h);
+            hash_value(state_hash, rs.font_space_v);
+            if(type == SSBGeometry::Type::POINTS)
+                hash_value(state_hash, rs.line_width);
+            hash_data(state_hash, rs.deform_x.data(), rs.deform_x.size());
+            hash_data(state_hash, rs.deform_y.data(), rs.deform_y.size());
+            hash_value(state_hash, rs.deform_progress);
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wfloat-equal"
-                        if(rs.pos_x == std::numeric_limits<decltype(rs.pos_x)>::max() && rs.pos_y == std::numeric_limits<decltype(rs.pos_y)>::max()){
+            hash_value(state_hash, rs.pos_x == std::numeric_limits<decltype(rs.pos_x)>::max() && rs.pos_y == std::numeric_limits<decltype(rs.pos_y)>::max());
 #pragma GCC diagnostic pop
-                            if(frame_scale_x > 0 && frame_scale_y > 0)
-                                wrap_width = (this->width - 2 * rs.margin_h) / frame_scale_x, wrap_height = (this->height - 2 * rs.margin_v) / frame_scale_y;
-                            else
-                                wrap_width = this->width - 2 * rs.margin_h, wrap_height = this->height - 2 * rs.margin_v;
-                        }else
-                            wrap_width = wrap_height = 0;
-                        // Work with geometry
-                        SSBGeometry* geometry = dynamic_cast<SSBGeometry*>(obj.get());
-                        switch(geometry->type){
-                            case SSBGeometry::Type::POINTS:
-                            case SSBGeometry::Type::PATH:
-                                {
-                                    // Get points / path dimensions
-                                    if(geometry->type == SSBGeometry::Type::POINTS)
-                                        points_to_cairo(dynamic_cast<SSBPoints*>(geometry), rs.line_width, this->stencil_path_buffer);
-                                    else
-                                        path_to_cairo(dynamic_cast<SSBPath*>(geometry), this->stencil_path_buffer);
-                                    double x1, y1, x2, y2; cairo_path_extents(this->stencil_path_buffer, &x1, &y1, &x2, &y2);
-                                    cairo_new_path(this->stencil_path_buffer);
-                                    x2 = std::max(x2, 0.0); y2 = std::max(y2, 0.0);
-                                    // Save render information
-                                    switch(rs.direction){
-                                        case SSBDirection::Mode::LTR:
-                                        case SSBDirection::Mode::RTL:
-                                            // Line wrap?
-                                            if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_width > 0 && render_sizes.back().lines.back().width + x2 > wrap_width){
-                                                render_sizes.back().lines.back().space = rs.font_space_v;
+            hash_value(state_hash, rs.align);
+            hash_value(state_hash, rs.margin_h);
+            hash_value(state_hash, rs.margin_v);
+            hash_value(state_hash, rs.direction);
+            states.push_back(rs);
+        }
+    // Reuse cached layout with current render states
+    const Renderer::LayoutKey key = {&event, frame_width, frame_height, state_hash};
+    if(this->layout_cache.contains(key)){
+        std::shared_ptr<Renderer::EventLayout> layout = std::make_shared<Renderer::EventLayout>(*this->layout_cache.get(key));
+        for(size_t i = 0; i < states.size(); ++i)
+            layout->geometries[i].rs = states[i];
+        return layout;
+    }
+    // Laid out geometries
+    std::shared_ptr<Renderer::EventLayout> layout = std::make_shared<Renderer::EventLayout>();
+    std::vector<Renderer::GeometryData>& geometries = layout->geometries;
+    // Reset render state
+    rs = {};
+    // Collect render sizes (position groups -> lines -> geometry positions)
+    std::vector<PosSize> render_sizes = {{}};
+    for(std::shared_ptr<SSBObject>& obj : event.objects)
+        if(obj->type == SSBObject::Type::TAG){
+            if(rs.eval_tag(dynamic_cast<SSBTag*>(obj.get()), start_ms - event.start_ms, event.end_ms - event.start_ms).position)
+                render_sizes.push_back({});
+        }else{  // obj->type == SSBObject::Type::GEOMETRY
+            // Calculate wrap limits
+            double wrap_width, wrap_height;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+            if(rs.pos_x == std::numeric_limits<decltype(rs.pos_x)>::max() && rs.pos_y == std::numeric_limits<decltype(rs.pos_y)>::max()){
+#pragma GCC diagnostic pop
+                wrap_width = frame_width - 2 * rs.margin_h, wrap_height = frame_height - 2 * rs.margin_v;
+            }else
+                wrap_width = wrap_height = 0;
+            // Work with geometry
+            SSBGeometry* geometry = dynamic_cast<SSBGeometry*>(obj.get());
+            switch(geometry->type){
+                case SSBGeometry::Type::POINTS:
+                case SSBGeometry::Type::PATH:
+                    {
+                        // Get points / path dimensions
+                        if(geometry->type == SSBGeometry::Type::POINTS)
+                            points_to_cairo(dynamic_cast<SSBPoints*>(geometry), rs.line_width, this->path_buffer);
+                        else
+                            path_to_cairo(dynamic_cast<SSBPath*>(geometry), this->path_buffer);
+                        double x1, y1, x2, y2; cairo_path_extents(this->path_buffer, &x1, &y1, &x2, &y2);
+                        cairo_new_path(this->path_buffer);
+                        x2 = std::max(x2, 0.0); y2 = std::max(y2, 0.0);
+                        // Save render information
+                        switch(rs.direction){
+                            case SSBDirection::Mode::LTR:
+                            case SSBDirection::Mode::RTL:
+                                // Line wrap?
+                                if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_width > 0 && render_sizes.back().lines.back().width + x2 > wrap_width){
+                                    render_sizes.back().lines.back().space = rs.font_space_v;
+                                    render_sizes.back().lines.push_back({});
+                                }
+                                // Save
+                                render_sizes.back().lines.back().geometries.push_back({render_sizes.back().lines.back().width, std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize) -> double{
+                                    return init + lsize.height + lsize.space;
+                                }), x2, y2});
+                                render_sizes.back().lines.back().width += x2;
+                                render_sizes.back().lines.back().height = std::max(render_sizes.back().lines.back().height, y2);
+                                render_sizes.back().width = std::max(render_sizes.back().width, render_sizes.back().lines.back().width);
+                                render_sizes.back().height = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
+                                    return init + lsize.height + lsize.space;
+                                });
+                                break;
+                            case SSBDirection::Mode::TTB:
+                                // Line wrap?
+                                if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_height > 0 && render_sizes.back().lines.back().height + y2 > wrap_height){
+                                    render_sizes.back().lines.back().space = rs.font_space_h;
+                                    render_sizes.back().lines.push_back({});
+                                }
+                                // Save
+                                render_sizes.back().lines.back().geometries.push_back({std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize){
+                                    return init + lsize.width + lsize.space;
+                                }), render_sizes.back().lines.back().height, x2, y2});
+                                render_sizes.back().lines.back().width = std::max(render_sizes.back().lines.back().width, x2);
+                                render_sizes.back().lines.back().height += y2;
+                                render_sizes.back().width = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
+                                    return init + lsize.width + lsize.space;
+                                });
+                                render_sizes.back().height = std::max(render_sizes.back().height, render_sizes.back().lines.back().height);
+                                break;
+                        }
+                    }
+                    break;
+                case SSBGeometry::Type::TEXT:
+                    {
+                        // Get font informations
+                        NativeFont font(rs.font_family, rs.bold, rs.italic, rs.underline, rs.strikeout, rs.font_size, rs.direction == SSBDirection::Mode::RTL);
+                        NativeFont::FontMetrics metrics = font.get_metrics();
+                        // Iterate through text lines
+                        std::stringstream text(dynamic_cast<SSBText*>(geometry)->text);
+                        unsigned long int line_i = 0;
+                        std::string line;
+                        while(getlineex(text, line)){
+                            if(++line_i > 1){
+                                render_sizes.back().lines.back().space = (rs.direction == SSBDirection::Mode::TTB) ? rs.font_space_h : metrics.descent + metrics.external_lead + rs.font_space_v;
+                                render_sizes.back().lines.push_back({});
+                            }
+                            switch(rs.direction){
+                                case SSBDirection::Mode::LTR:
+                                case SSBDirection::Mode::RTL:
+                                    {
+                                        // Width calculation
+                                        auto get_text_width = [&font,&rs](std::string& text) -> double{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+                                            if(rs.font_space_h != 0){
+#pragma GCC diagnostic pop
+                                                double width = 0;
+                                                std::vector<std::string> chars = utf8_chars(text);
+                                                for(std::string& c : chars)
+                                                    width += font.get_text_width(c) + rs.font_space_h;
+                                                return width;
+                                            }else
+                                                return font.get_text_width(text);
+                                        };
+                                        // Words iteration
+                                        std::vector<Word> words = getwords(line);
+                                        std::string merged_word;
+                                        double width;
+                                        for(Word& word : words){
+                                            merged_word = word.prespace + word.text;
+                                            width = get_text_width(merged_word);
+                                            if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_width > 0 && render_sizes.back().lines.back().width + width > wrap_width){
+                                                render_sizes.back().lines.back().space = metrics.descent + metrics.external_lead + rs.font_space_v;
                                                 render_sizes.back().lines.push_back({});
+                                                width = get_text_width(word.text);
                                             }
-                                            // Save
-                                            render_sizes.back().lines.back().geometries.push_back({render_sizes.back().lines.back().width, std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize) -> double{
+                                            render_sizes.back().lines.back().geometries.push_back({render_sizes.back().lines.back().width, std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize){
                                                 return init + lsize.height + lsize.space;
-                                            }), x2, y2});
-                                            render_sizes.back().lines.back().width += x2;
-                                            render_sizes.back().lines.back().height = std::max(render_sizes.back().lines.back().height, y2);
+                                            }), width, metrics.internal_lead + metrics.ascent});
+                                            render_sizes.back().lines.back().width += width;
+                                            render_sizes.back().lines.back().height = std::max(render_sizes.back().lines.back().height, metrics.internal_lead + metrics.ascent);
                                             render_sizes.back().width = std::max(render_sizes.back().width, render_sizes.back().lines.back().width);
-                                            render_sizes.back().height = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
-                                                return init + lsize.height + lsize.space;
-                                            });
-                                            break;
-                                        case SSBDirection::Mode::TTB:
-                                            // Line wrap?
-                                            if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_height > 0 && render_sizes.back().lines.back().height + y2 > wrap_height){
+                                        }
+                                        // Update position render height
+                                        render_sizes.back().height = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
+                                            return init + lsize.height + lsize.space;
+                                        });
+                                    }
+                                    break;
+                                case SSBDirection::Mode::TTB:
+                                    {
+                                        // Extents calculation
+                                        auto get_text_extents = [&font,&metrics,&rs](std::string& text, double& width, double& height){
+                                            width = height = 0;
+                                            std::vector<std::string> chars = utf8_chars(text);
+                                            for(std::string& c : chars){
+                                                width = std::max(width, font.get_text_width(c));
+                                                height += metrics.internal_lead + metrics.ascent + rs.font_space_v;
+                                            }
+                                        };
+                                        // Words iteration
+                                        std::vector<Word> words = getwords(line);
+                                        std::string merged_word;
+                                        double width, height;
+                                        for(Word& word : words){
+                                            merged_word = word.prespace + word.text;
+                                            get_text_extents(merged_word, width, height);
+                                            if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_height > 0 && render_sizes.back().lines.back().height + height > wrap_height){
                                                 render_sizes.back().lines.back().space = rs.font_space_h;
                                                 render_sizes.back().lines.push_back({});
+                                                get_text_extents(word.text, width, height);
                                             }
-                                            // Save
                                             render_sizes.back().lines.back().geometries.push_back({std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize){
                                                 return init + lsize.width + lsize.space;
-                                            }), render_sizes.back().lines.back().height, x2, y2});
-                                            render_sizes.back().lines.back().width = std::max(render_sizes.back().lines.back().width, x2);
-                                            render_sizes.back().lines.back().height += y2;
-                                            render_sizes.back().width = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
-                                                return init + lsize.width + lsize.space;
-                                            });
+                                            }), render_sizes.back().lines.back().height, width, height});
+                                            render_sizes.back().lines.back().width = std::max(render_sizes.back().lines.back().width, width);
+                                            render_sizes.back().lines.back().height += height;
                                             render_sizes.back().height = std::max(render_sizes.back().height, render_sizes.back().lines.back().height);
-                                            break;
-                                    }
-                                }
-                                break;
-                            case SSBGeometry::Type::TEXT:
-                                {
-                                    // Get font informations
-                                    NativeFont font(rs.font_family, rs.bold, rs.italic, rs.underline, rs.strikeout, rs.font_size, rs.direction == SSBDirection::Mode::RTL);
-                                    NativeFont::FontMetrics metrics = font.get_metrics();
-                                    // Iterate through text lines
-                                    std::stringstream text(dynamic_cast<SSBText*>(geometry)->text);
-                                    unsigned long int line_i = 0;
-                                    std::string line;
-                                    while(getlineex(text, line)){
-                                        if(++line_i > 1){
-                                            render_sizes.back().lines.back().space = (rs.direction == SSBDirection::Mode::TTB) ? rs.font_space_h : metrics.descent + metrics.external_lead + rs.font_space_v;
-                                            render_sizes.back().lines.push_back({});
-                                        }
-                                        switch(rs.direction){
-                                            case SSBDirection::Mode::LTR:
-                                            case SSBDirection::Mode::RTL:
-                                                {
-                                                    // Width calculation
-                                                    auto get_text_width = [&font,&rs](std::string& text) -> double{
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wfloat-equal"
-                                                        if(rs.font_space_h != 0){
-#pragma GCC diagnostic pop
-                                                            double width = 0;
-                                                            std::vector<std::string> chars = utf8_chars(text);
-                                                            for(std::string& c : chars)
-                                                                width += font.get_text_width(c) + rs.font_space_h;
-                                                            return width;
-                                                        }else
-                                                            return font.get_text_width(text);
-                                                    };
-                                                    // Words iteration
-                                                    std::vector<Word> words = getwords(line);
-                                                    std::string merged_word;
-                                                    double width;
-                                                    for(Word& word : words){
-                                                        merged_word = word.prespace + word.text;
-                                                        width = get_text_width(merged_word);
-                                                        if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_width > 0 && render_sizes.back().lines.back().width + width > wrap_width){
-                                                            render_sizes.back().lines.back().space = metrics.descent + metrics.external_lead + rs.font_space_v;
-                                                            render_sizes.back().lines.push_back({});
-                                                            width = get_text_width(word.text);
-                                                        }
-                                                        render_sizes.back().lines.back().geometries.push_back({render_sizes.back().lines.back().width, std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize){
-                                                            return init + lsize.height + lsize.space;
-                                                        }), width, metrics.internal_lead + metrics.ascent});
-                                                        render_sizes.back().lines.back().width += width;
-                                                        render_sizes.back().lines.back().height = std::max(render_sizes.back().lines.back().height, metrics.internal_lead + metrics.ascent);
-                                                        render_sizes.back().width = std::max(render_sizes.back().width, render_sizes.back().lines.back().width);
-                                                    }
-                                                    // Update position render height
-                                                    render_sizes.back().height = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
-                                                        return init + lsize.height + lsize.space;
-                                                    });
-                                                }
-                                                break;
-                                            case SSBDirection::Mode::TTB:
-                                                {
-                                                    // Extents calculation
-                                                    auto get_text_extents = [&font,&metrics,&rs](std::string& text, double& width, double& height){
-                                                        width = height = 0;
-                                                        std::vector<std::string> chars = utf8_chars(text);
-                                                        for(std::string& c : chars){
-                                                            width = std::max(width, font.get_text_width(c));
-                                                            height += metrics.internal_lead + metrics.ascent + rs.font_space_v;
-                                                        }
-                                                    };
-                                                    // Words iteration
-                                                    std::vector<Word> words = getwords(line);
-                                                    std::string merged_word;
-                                                    double width, height;
-                                                    for(Word& word : words){
-                                                        merged_word = word.prespace + word.text;
-                                                        get_text_extents(merged_word, width, height);
-                                                        if(render_sizes.back().lines.back().geometries.size() > 0 && wrap_height > 0 && render_sizes.back().lines.back().height + height > wrap_height){
-                                                            render_sizes.back().lines.back().space = rs.font_space_h;
-                                                            render_sizes.back().lines.push_back({});
-                                                            get_text_extents(word.text, width, height);
-                                                        }
-                                                        render_sizes.back().lines.back().geometries.push_back({std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end()-1, 0.0, [](double init, LineSize& lsize){
-                                                            return init + lsize.width + lsize.space;
-                                                        }), render_sizes.back().lines.back().height, width, height});
-                                                        render_sizes.back().lines.back().width = std::max(render_sizes.back().lines.back().width, width);
-                                                        render_sizes.back().lines.back().height += height;
-                                                        render_sizes.back().height = std::max(render_sizes.back().height, render_sizes.back().lines.back().height);
-                                                    }
-                                                    // Update position render width
-                                                    render_sizes.back().width = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
-                                                        return init + lsize.width + lsize.space;
-                                                    });
-                                                }
-                                                break;
                                         }
+                                        // Update position render width
+                                        render_sizes.back().width = std::accumulate(render_sizes.back().lines.begin(), render_sizes.back().lines.end(), 0.0, [](double init, LineSize& lsize){
+                                            return init + lsize.width + lsize.space;
+                                        });
                                     }
-                                }
-                                break;
+                                    break;
+                            }
                         }
                     }
-                // Reset render state
-                rs = {};
-                // Define geometry path
-                struct{
-                    size_t pos = 0, line = 0, geometry = 0;
-                }size_index;
-                for(std::shared_ptr<SSBObject>& obj : event.objects)
-                    if(obj->type == SSBObject::Type::TAG){
-                        // Apply tag to render state
-                        if(rs.eval_tag(dynamic_cast<SSBTag*>(obj.get()), start_ms - event.start_ms, event.end_ms - event.start_ms).position){
-                            ++size_index.pos;
-                            size_index.line = size_index.geometry = 0;
+                    break;
+            }
+        }
+    // Reset render state
+    rs = {};
+    // Define geometry path
+    struct{
+        size_t pos = 0, line = 0, geometry = 0;
+    }size_index;
+    for(std::shared_ptr<SSBObject>& obj : event.objects)
+        if(obj->type == SSBObject::Type::TAG){
+            // Apply tag to render state
+            if(rs.eval_tag(dynamic_cast<SSBTag*>(obj.get()), start_ms - event.start_ms, event.end_ms - event.start_ms).position){
+                ++size_index.pos;
+                size_index.line = size_index.geometry = 0;
+            }
+        }else{  // obj->type == SSBObject::Type::GEOMETRY
+            // Create geometry
+            SSBGeometry* geometry = dynamic_cast<SSBGeometry*>(obj.get());
+            Point align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], size_index.line);
+            std::shared_ptr<std::vector<Point>> points;
+            switch(geometry->type){
+                case SSBGeometry::Type::POINTS:
+                case SSBGeometry::Type::PATH:
+                    // Update geometry index by newline
+                    if(size_index.geometry >= render_sizes[size_index.pos].lines[size_index.line].geometries.size()){
+                        align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
+                        size_index.geometry = 0;
+                    }
+                    // Save geometries matrix
+                    cairo_save(this->path_buffer);
+                    // Set transformation for alignment
+                    cairo_translate(this->path_buffer, align_point.x, align_point.y + render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_y);
+                    switch(rs.direction){
+                        case SSBDirection::Mode::LTR:
+                            cairo_translate(this->path_buffer,
+                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x,
+                                            0);
+                            break;
+                        case SSBDirection::Mode::RTL:
+                            cairo_translate(this->path_buffer,
+                                            render_sizes[size_index.pos].lines[size_index.line].width -
+                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x -
+                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].width,
+                                            0);
+                            break;
+                        case SSBDirection::Mode::TTB:
+                            cairo_translate(this->path_buffer,
+                                            render_sizes[size_index.pos].width -
+                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x -
+                                            render_sizes[size_index.pos].lines[size_index.line].width + (render_sizes[size_index.pos].lines[size_index.line].width - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].width) / 2,
+                                            0);
+                            break;
+                    }
+                    // Draw aligned points / path
+                    if(geometry->type == SSBGeometry::Type::POINTS){
+                        points_to_cairo(dynamic_cast<SSBPoints*>(geometry), rs.line_width, this->path_buffer);
+                        // Save aligned point centers (alignment is just a translation)
+                        if(rs.deform_x.empty() && rs.deform_y.empty()){
+                            cairo_matrix_t align_matrix; cairo_get_matrix(this->path_buffer, &align_matrix);
+                            points = std::make_shared<std::vector<Point>>(dynamic_cast<SSBPoints*>(geometry)->points);
+                            for(Point& point : *points)
+                                point.x += align_matrix.x0,
+                                point.y += align_matrix.y0;
                         }
-                    }else{  // obj->type == SSBObject::Type::GEOMETRY
-                        // Create geometry
-                        SSBGeometry* geometry = dynamic_cast<SSBGeometry*>(obj.get());
-                        Point align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], size_index.line);
-                        switch(geometry->type){
-                            case SSBGeometry::Type::POINTS:
-                            case SSBGeometry::Type::PATH:
-                                // Update geometry index by newline
-                                if(size_index.geometry >= render_sizes[size_index.pos].lines[size_index.line].geometries.size()){
-                                    align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
-                                    size_index.geometry = 0;
-                                }
-                                // Save geometries matrix
-                                cairo_save(this->stencil_path_buffer);
-                                // Set transformation for alignment
-                                cairo_translate(this->stencil_path_buffer, align_point.x, align_point.y + render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_y);
-                                switch(rs.direction){
-                                    case SSBDirection::Mode::LTR:
-                                        cairo_translate(this->stencil_path_buffer,
-                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x,
-                                                        0);
-                                        break;
-                                    case SSBDirection::Mode::RTL:
-                                        cairo_translate(this->stencil_path_buffer,
-                                                        render_sizes[size_index.pos].lines[size_index.line].width -
-                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x -
-                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].width,
-                                                        0);
-                                        break;
-                                    case SSBDirection::Mode::TTB:
-                                        cairo_translate(this->stencil_path_buffer,
-                                                        render_sizes[size_index.pos].width -
-                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x -
-                                                        render_sizes[size_index.pos].lines[size_index.line].width + (render_sizes[size_index.pos].lines[size_index.line].width - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].width) / 2,
-                                                        0);
-                                        break;
-                                }
-                                // Draw aligned points / path
-                                if(geometry->type == SSBGeometry::Type::POINTS)
-                                    points_to_cairo(dynamic_cast<SSBPoints*>(geometry), rs.line_width, this->stencil_path_buffer);
-                                else
-                                    path_to_cairo(dynamic_cast<SSBPath*>(geometry), this->stencil_path_buffer);
-                                // Restore geometries matrix
-                                cairo_restore(this->stencil_path_buffer);
-                                break;
-                            case SSBGeometry::Type::TEXT:
-                                {
-                                    // Get font informations
-                                    NativeFont font(rs.font_family, rs.bold, rs.italic, rs.underline, rs.strikeout, rs.font_size, rs.direction == SSBDirection::Mode::RTL);
-                                    NativeFont::FontMetrics metrics = font.get_metrics();
-                                    // Iterate through text lines
-                                    std::stringstream text(dynamic_cast<SSBText*>(geometry)->text);
-                                    unsigned long int line_i = 0;
-                                    std::string line;
-                                    while(getlineex(text, line)){
-                                        // Recalculate data for new line
-                                        if(++line_i > 1){
-                                            align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
-                                            size_index.geometry = 0;
-                                        }
-                                        // Draw line
-                                        switch(rs.direction){
-                                            case SSBDirection::Mode::LTR:
-                                            case SSBDirection::Mode::RTL:
-                                                {
-                                                    std::vector<Word> words = getwords(line);
-                                                    std::string merged_word;
-                                                    for(Word& word : words){
-                                                        merged_word = word.prespace + word.text;
-                                                        // Update geometry index by newline
-                                                        if(size_index.geometry >= render_sizes[size_index.pos].lines[size_index.line].geometries.size()){
-                                                            align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
-                                                            size_index.geometry = 0;
-                                                            merged_word = word.text;
-                                                        }
-                                                        // Define path
-                                                        cairo_save(this->stencil_path_buffer);
-                                                        cairo_translate(this->stencil_path_buffer,
-                                                                        align_point.x +
-                                                                        (rs.direction == SSBDirection::Mode::LTR ?
-                                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x :
-                                                                        render_sizes[size_index.pos].lines[size_index.line].width - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].width),
-                                                                        align_point.y +
-                                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_y +
-                                                                        (render_sizes[size_index.pos].lines[size_index.line].height - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].height));
+                    }else
+                        path_to_cairo(dynamic_cast<SSBPath*>(geometry), this->path_buffer);
+                    // Restore geometries matrix
+                    cairo_restore(this->path_buffer);
+                    break;
+                case SSBGeometry::Type::TEXT:
+                    {
+                        // Get font informations
+                        NativeFont font(rs.font_family, rs.bold, rs.italic, rs.underline, rs.strikeout, rs.font_size, rs.direction == SSBDirection::Mode::RTL);
+                        NativeFont::FontMetrics metrics = font.get_metrics();
+                        // Iterate through text lines
+                        std::stringstream text(dynamic_cast<SSBText*>(geometry)->text);
+                        unsigned long int line_i = 0;
+                        std::string line;
+                        while(getlineex(text, line)){
+                            // Recalculate data for new line
+                            if(++line_i > 1){
+                                align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
+                                size_index.geometry = 0;
+                            }
+                            // Draw line
+                            switch(rs.direction){
+                                case SSBDirection::Mode::LTR:
+                                case SSBDirection::Mode::RTL:
+                                    {
+                                        std::vector<Word> words = getwords(line);
+                                        std::string merged_word;
+                                        for(Word& word : words){
+                                            merged_word = word.prespace + word.text;
+                                            // Update geometry index by newline
+                                            if(size_index.geometry >= render_sizes[size_index.pos].lines[size_index.line].geometries.size()){
+                                                align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
+                                                size_index.geometry = 0;
+                                                merged_word = word.text;
+                                            }
+                                            // Define path
+                                            cairo_save(this->path_buffer);
+                                            cairo_translate(this->path_buffer,
+                                                            align_point.x +
+                                                            (rs.direction == SSBDirection::Mode::LTR ?
+                                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x :
+                                                            render_sizes[size_index.pos].lines[size_index.line].width - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].width),
+                                                            align_point.y +
+                                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_y +
+                                                            (render_sizes[size_index.pos].lines[size_index.line].height - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].height));
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wfloat-equal"
-                                                        if(rs.font_space_h != 0){
+                                            if(rs.font_space_h != 0){
 #pragma GCC diagnostic pop
-                                                            std::vector<std::string> chars = utf8_chars(merged_word);
-                                                            for(std::string& c: chars){
-                                                                font.text_path_to_cairo(c, this->stencil_path_buffer);
-                                                                cairo_translate(this->stencil_path_buffer, font.get_text_width(c) + rs.font_space_h, 0);
-                                                            }
-                                                        }else
-                                                            font.text_path_to_cairo(merged_word, this->stencil_path_buffer);
-                                                        cairo_restore(this->stencil_path_buffer);
-                                                        // Increase geometry index
-                                                        if(&word != &words.back())
-                                                            ++size_index.geometry;
-                                                    }
+                                                std::vector<std::string> chars = utf8_chars(merged_word);
+                                                for(std::string& c: chars){
+                                                    font.text_path_to_cairo(c, this->path_buffer);
+                                                    cairo_translate(this->path_buffer, font.get_text_width(c) + rs.font_space_h, 0);
                                                 }
-                                                break;
-                                            case SSBDirection::Mode::TTB:
-                                                {
-                                                    std::vector<Word> words = getwords(line);
-                                                    std::string merged_word;
-                                                    for(Word& word : words){
-                                                        merged_word = word.prespace + word.text;
-                                                        // Update geometry index by newline
-                                                        if(size_index.geometry >= render_sizes[size_index.pos].lines[size_index.line].geometries.size()){
-                                                            align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
-                                                            size_index.geometry = 0;
-                                                            merged_word = word.text;
-                                                        }
-                                                        // Define path
-                                                        cairo_save(this->stencil_path_buffer);
-                                                        cairo_translate(this->stencil_path_buffer,
-                                                                        align_point.x +
-                                                                        render_sizes[size_index.pos].width - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x - render_sizes[size_index.pos].lines[size_index.line].width,
-                                                                        align_point.y +
-                                                                        render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_y);
-                                                        std::vector<std::string> chars = utf8_chars(merged_word);
-                                                        for(std::string& c: chars){
-                                                            cairo_save(this->stencil_path_buffer);
-                                                            cairo_translate(this->stencil_path_buffer,
-                                                                            (render_sizes[size_index.pos].lines[size_index.line].width - font.get_text_width(c)) / 2,
-                                                                            0);
-                                                            font.text_path_to_cairo(c, this->stencil_path_buffer);
-                                                            cairo_restore(this->stencil_path_buffer);
-                                                            cairo_translate(this->stencil_path_buffer, 0, metrics.internal_lead + metrics.ascent + rs.font_space_v);
-                                                        }
-                                                        cairo_restore(this->stencil_path_buffer);
-                                                        // Increase geometry index
-                                                        if(&word != &words.back())
-                                                            ++size_index.geometry;
-                                                    }
-                                                }
-                                                break;
+                                            }else
+                                                font.text_path_to_cairo(merged_word, this->path_buffer);
+                                            cairo_restore(this->path_buffer);
+                                            // Increase geometry index
+                                            if(&word != &words.back())
+                                                ++size_index.geometry;
                                         }
                                     }
-                                }
-                                break;
+                                    break;
+                                case SSBDirection::Mode::TTB:
+                                    {
+                                        std::vector<Word> words = getwords(line);
+                                        std::string merged_word;
+                                        for(Word& word : words){
+                                            merged_word = word.prespace + word.text;
+                                            // Update geometry index by newline
+                                            if(size_index.geometry >= render_sizes[size_index.pos].lines[size_index.line].geometries.size()){
+                                                align_point = calc_align_offset(rs.align, rs.direction, render_sizes[size_index.pos], ++size_index.line);
+                                                size_index.geometry = 0;
+                                                merged_word = word.text;
+                                            }
+                                            // Define path
+                                            cairo_save(this->path_buffer);
+                                            cairo_translate(this->path_buffer,
+                                                            align_point.x +
+                                                            render_sizes[size_index.pos].width - render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_x - render_sizes[size_index.pos].lines[size_index.line].width,
+                                                            align_point.y +
+                                                            render_sizes[size_index.pos].lines[size_index.line].geometries[size_index.geometry].off_y);
+                                            std::vector<std::string> chars = utf8_chars(merged_word);
+                                            for(std::string& c: chars){
+                                                cairo_save(this->path_buffer);
+                                                cairo_translate(this->path_buffer,
+                                                                (render_sizes[size_index.pos].lines[size_index.line].width - font.get_text_width(c)) / 2,
+                                                                0);
+                                                font.text_path_to_cairo(c, this->path_buffer);
+                                                cairo_restore(this->path_buffer);
+                                                cairo_translate(this->path_buffer, 0, metrics.internal_lead + metrics.ascent + rs.font_space_v);
+                                            }
+                                            cairo_restore(this->path_buffer);
+                                            // Increase geometry index
+                                            if(&word != &words.back())
+                                                ++size_index.geometry;
+                                        }
+                                    }
+                                    break;
+                            }
                         }
-                        // Increase geometry index
-                        ++size_index.geometry;
-                        // Deform geometry
-                        if(!rs.deform_x.empty() || !rs.deform_y.empty())
-                            path_deform(this->stencil_path_buffer, rs.deform_x, rs.deform_y, rs.deform_progress);
-                        // Get original geometry dimensions (for color shifting to geometry)
-                        double x1, y1, x2, y2; cairo_path_extents(this->stencil_path_buffer, &x1, &y1, &x2, &y2);
-                        int fill_x = floor(x1), fill_y = floor(y1), fill_width = ceil(x2) - fill_x, fill_height = ceil(y2) - fill_y;
-                        // Transform matrix
-                        cairo_matrix_t matrix = {1, 0, 0, 1, 0, 0};
+                    }
+                    break;
+            }
+            // Increase geometry index
+            ++size_index.geometry;
+            // Deform geometry
+            if(!rs.deform_x.empty() || !rs.deform_y.empty())
+                path_deform(this->path_buffer, rs.deform_x, rs.deform_y, rs.deform_progress);
+            // Save geometry with untransformed path & his dimensions
+            double x1, y1, x2, y2; cairo_path_extents(this->path_buffer, &x1, &y1, &x2, &y2);
+            cairo_path_t* path = cairo_copy_path(this->path_buffer);
+            geometries.push_back({geometry->type, rs, std::make_shared<const CairoPath>(path), x1, y1, x2, y2, points});
+            cairo_path_destroy(path);
+            // Clear path
+            cairo_new_path(this->path_buffer);
+        }
+    // Save layout to cache (static events get cached as images anyway)
+    if(!event.static_tags)
+        this->layout_cache.add(key, layout);
+    return layout;
+}
+
+void Renderer::draw_event(SSBEvent& event, const SSBFrame& script_frame, const std::string& script_dir, std::vector<Renderer::GeometryData>& geometries, unsigned long int start_ms,
+                          const Renderer::Target& target, const Renderer::Rect& region, std::vector<Renderer::ImageData>& event_images){
+    // Move stencil to area (content kept, new parts empty, no area releases stencil)
+    auto set_stencil_rect = [this](const Renderer::Rect& rect){
+        if(rect.width > 0 && rect.height > 0){
+            if(rect.x == this->stencil_rect.x && rect.y == this->stencil_rect.y && rect.width == this->stencil_rect.width && rect.height == this->stencil_rect.height)
+                return;
+            CairoImage stencil(rect.width, rect.height, CAIRO_FORMAT_A8);
+            if(this->stencil_rect.width > 0){
+                cairo_set_source_surface(stencil, this->stencil, this->stencil_rect.x - rect.x, this->stencil_rect.y - rect.y);
+                cairo_paint(stencil);
+            }
+            this->stencil = stencil;
+            this->stencil_rect = rect;
+        }else if(this->stencil_rect.width > 0){
+            this->stencil = CairoImage();
+            this->stencil_rect = {0, 0, 0, 0};
+        }
+    };
+    // Calculate image-to-video scale
+    double frame_scale_x, frame_scale_y;
+    if(script_frame.width > 0 && script_frame.height > 0)
+        frame_scale_x = static_cast<double>(target.width) / script_frame.width, frame_scale_y = static_cast<double>(target.height) / script_frame.height;
+    else
+        frame_scale_x = frame_scale_y = 0;
+    // Coverage masks of geometries (unclipped by region, reused for events with just color animations)
+    const bool use_masks = has_animations_only(event, {SSBTag::Type::COLOR, SSBTag::Type::ALPHA, SSBTag::Type::LINE_COLOR, SSBTag::Type::LINE_ALPHA});
+    const Renderer::CacheKey mask_key = {&event, target.width, target.height, 0};
+    std::vector<Renderer::MaskData> masks = use_masks && this->mask_cache.contains(mask_key) ? this->mask_cache.get(mask_key) : std::vector<Renderer::MaskData>(geometries.size());
+    bool masks_changed = false;
+    // Subpixel phase rasters of geometries (reused for events with just translation animations)
+    const bool use_phases = this->subpixel_phases > 0 && has_animations_only(event, {SSBTag::Type::POSITION, SSBTag::Type::TRANSLATE});
+    // Unhighlighted + highlighted rasters of karaoke geometries (unclipped by region, reused for events without animations)
+    const bool use_karaokes = has_karaoke_only(event);
+    // Iterate through laid out geometries
+    for(size_t geometry_i = 0; geometry_i < geometries.size(); ++geometry_i){
+        Renderer::GeometryData& geometry = geometries[geometry_i];
+        // Render state at geometry
+        RenderState& rs = geometry.rs;
+        // Get original geometry dimensions (for color shifting to geometry)
+        int fill_x = floor(geometry.x1), fill_y = floor(geometry.y1), fill_width = ceil(geometry.x2) - fill_x, fill_height = ceil(geometry.y2) - fill_y;
+        // Transform matrix
+        cairo_matrix_t matrix = {1, 0, 0, 1, 0, 0};
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wfloat-equal"
-                        if(!(rs.pos_x == std::numeric_limits<decltype(rs.pos_x)>::max() && rs.pos_y == std::numeric_limits<decltype(rs.pos_y)>::max())){
+        if(!(rs.pos_x == std::numeric_limits<decltype(rs.pos_x)>::max() && rs.pos_y == std::numeric_limits<decltype(rs.pos_y)>::max())){
 #pragma GCC diagnostic pop
-                            if(frame_scale_x > 0 && frame_scale_y > 0)
-                                cairo_matrix_scale(&matrix, frame_scale_x, frame_scale_y);
-                            cairo_matrix_translate(&matrix, rs.pos_x, rs.pos_y);
-                        }else{
-                            if(frame_scale_x > 0 && frame_scale_y > 0){
-                                Point pos = get_auto_pos(this->width, this->height, rs.align, rs.margin_h, rs.margin_v, frame_scale_x, frame_scale_y);
-                                cairo_matrix_translate(&matrix, pos.x, pos.y);
-                                cairo_matrix_scale(&matrix, frame_scale_x, frame_scale_y);
-                            }else{
-                                Point pos = get_auto_pos(this->width, this->height, rs.align, rs.margin_h, rs.margin_v);
-                                cairo_matrix_translate(&matrix, pos.x, pos.y);
-                            }
-                        }
-                        cairo_matrix_multiply(&matrix, &rs.matrix, &matrix);
-                        cairo_apply_matrix(this->stencil_path_buffer, &matrix);
-                        // Get transformed geometry dimensions (for overlay image)
-                        cairo_path_extents(this->stencil_path_buffer, &x1, &y1, &x2, &y2);
-                        int x = floor(x1), y = floor(y1), width = ceil(x2 - x), height = ceil(y2 - y);
-                        // Set line properties
-                        if(frame_scale_x > 0 && frame_scale_y > 0)
-                            set_line_props(this->stencil_path_buffer, rs, (frame_scale_x + frame_scale_y) / 2);
-                        else
-                            set_line_props(this->stencil_path_buffer, rs);
-                        // Create overlay by type
-                        enum class DrawType{FILL_BLURRED, FILL_WITHOUT_BLUR, BORDER, BOX, WIRE};
-                        auto create_overlay = [&](DrawType draw_type) -> Renderer::ImageData{
-                            /*
-                                CODE FOR PERFORMANCE TESTING ON WINDOWS
-
-                                LARGE_INTEGER freq, t1, t2;
-                                QueryPerformanceFrequency(&freq);
-                                QueryPerformanceCounter(&t1);
-                                // INSERT CODE
-                                QueryPerformanceCounter(&t2);
-                                std::ostringstream s;
-                                s << "Duration: " << (static_cast<double>(t2.QuadPart - t1.QuadPart) / freq.QuadPart * 1000) << "ms";
-                                MessageBoxA(NULL, s.str().c_str(), "Performance", MB_OK);
-                            */
-                            // Create image
-                            int border_h = 0, border_v = 0;
-                            switch(draw_type){
-                                case DrawType::WIRE:
-                                case DrawType::BORDER:
-                                case DrawType::BOX:
-                                    border_h = ceil(rs.blur_h) + ceil(cairo_get_line_width(this->stencil_path_buffer) / 2),
-                                    border_v = ceil(rs.blur_v) + ceil(cairo_get_line_width(this->stencil_path_buffer) / 2);
-                                    break;
-                                case DrawType::FILL_BLURRED:
-                                    border_h = ceil(rs.blur_h),
-                                    border_v = ceil(rs.blur_v);
-                                    break;
-                                case DrawType::FILL_WITHOUT_BLUR:
-                                    // Border already with zero initialized
-                                    break;
-                            }
-                            CairoImage image(width + (border_h << 1), height + (border_v << 1), CAIRO_FORMAT_ARGB32);
-                            cairo_set_antialias(image, rs.aa);
-                            // Anything visible?
+            if(frame_scale_x > 0 && frame_scale_y > 0)
+                cairo_matrix_scale(&matrix, frame_scale_x, frame_scale_y);
+            cairo_matrix_translate(&matrix, rs.pos_x, rs.pos_y);
+        }else{
+            if(frame_scale_x > 0 && frame_scale_y > 0){
+                Point pos = get_auto_pos(target.width, target.height, rs.align, rs.margin_h, rs.margin_v, frame_scale_x, frame_scale_y);
+                cairo_matrix_translate(&matrix, pos.x, pos.y);
+                cairo_matrix_scale(&matrix, frame_scale_x, frame_scale_y);
+            }else{
+                Point pos = get_auto_pos(target.width, target.height, rs.align, rs.margin_h, rs.margin_v);
+                cairo_matrix_translate(&matrix, pos.x, pos.y);
+            }
+        }
+        cairo_matrix_multiply(&matrix, &rs.matrix, &matrix);
+        // Get line width (see set_line_props)
+        const double line_width = (rs.mode == SSBMode::Mode::FILL || rs.mode == SSBMode::Mode::BOXED ? rs.line_width * 2 : rs.line_width) *
+            (frame_scale_x > 0 && frame_scale_y > 0 ? (frame_scale_x + frame_scale_y) / 2 : 1);
+        // Get reach of border + blur beyond geometry
+        const int reach_h = ceil(rs.blur_h) + ceil(line_width / 2),
+            reach_v = ceil(rs.blur_v) + ceil(line_width / 2);
+        // Skip geometry outside render region (by transformed original extents, before path transformation + image allocation)
+        double box_x1 = std::numeric_limits<double>::max(), box_y1 = std::numeric_limits<double>::max(),
+            box_x2 = std::numeric_limits<double>::lowest(), box_y2 = std::numeric_limits<double>::lowest();
+        const double corners[4][2] = {{geometry.x1, geometry.y1}, {geometry.x2, geometry.y1}, {geometry.x1, geometry.y2}, {geometry.x2, geometry.y2}};
+        for(const auto& corner : corners){
+            double corner_x = corner[0], corner_y = corner[1];
+            cairo_matrix_transform_point(&matrix, &corner_x, &corner_y);
+            box_x1 = std::min(box_x1, corner_x),
+            box_y1 = std::min(box_y1, corner_y),
+            box_x2 = std::max(box_x2, corner_x),
+            box_y2 = std::max(box_y2, corner_y);
+        }
+        if(floor(box_x1) - reach_h >= region.x + region.width || floor(box_y1) - reach_v >= region.y + region.height ||
+           ceil(box_x2) + reach_h <= region.x || ceil(box_y2) + reach_v <= region.y){
+            // Unsetting clears stencil outside the geometry, so everything in region
+            if(rs.stencil_mode == SSBStencil::Mode::UNSET)
+                set_stencil_rect({0, 0, 0, 0});
+            continue;
+        }
+        // Split translation into pixel shift + quantized subpixel phase (unstenciled geometries of translation animated events, not exceeding target frame)
+        // Decided by event + target only, so region renderings quantize like full frame renderings
+        const bool use_phase = use_phases && rs.stencil_mode == SSBStencil::Mode::OFF &&
+            box_x2 - box_x1 + (reach_h << 1) <= target.width && box_y2 - box_y1 + (reach_v << 1) <= target.height;
+        int shift_x = 0, shift_y = 0, phase_x = 0, phase_y = 0;
+        if(use_phase){
+            phase_x = floor((matrix.x0 - floor(matrix.x0)) * this->subpixel_phases + 0.5),
+            phase_y = floor((matrix.y0 - floor(matrix.y0)) * this->subpixel_phases + 0.5);
+            shift_x = floor(matrix.x0) + phase_x / this->subpixel_phases,
+            shift_y = floor(matrix.y0) + phase_y / this->subpixel_phases;
+            phase_x %= this->subpixel_phases,
+            phase_y %= this->subpixel_phases;
+            matrix.x0 = static_cast<double>(phase_x) / this->subpixel_phases,
+            matrix.y0 = static_cast<double>(phase_y) / this->subpixel_phases;
+        }
+        // Transform path
+        const CairoPath path = geometry.path->transformed(matrix);
+        // Get transformed geometry dimensions (for overlay image)
+        double x1, y1, x2, y2; path.extents(x1, y1, x2, y2);
+        int x = floor(x1), y = floor(y1), width = ceil(x2 - x), height = ceil(y2 - y);
+        // Stamp dot sprites for points instead of filling their circles/squares (if transformation keeps dots in shape)
+        const double dot_scale = std::sqrt(matrix.xx * matrix.xx + matrix.yx * matrix.yx),
+            dot_size = rs.line_width * dot_scale;
+        // Dots without common pixels (stamped union of overlapping dots differs from filling, so they get filled)
+        auto dots_apart = [&]() -> bool{
+            std::vector<Point> centers;
+            for(Point center : *geometry.points)
+                cairo_matrix_transform_point(&matrix, &center.x, &center.y),
+                centers.push_back(center);
+            std::sort(centers.begin(), centers.end(), [](const Point& a, const Point& b){return a.x < b.x;});
+            const double reach = dot_size + 2;
+            for(size_t i = 0; i < centers.size(); ++i)
+                for(size_t j = i + 1; j < centers.size() && centers[j].x - centers[i].x < reach; ++j)
+                    if(std::abs(centers[j].y - centers[i].y) < reach)
+                        return false;
+            return true;
+        };
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wfloat-equal"
-                            if(
-                                ((draw_type == DrawType::FILL_BLURRED || draw_type == DrawType::FILL_WITHOUT_BLUR) && !std::all_of(rs.alphas, rs.alphas+4, [](double& a){return a == 0.0;})) ||
-                                ((draw_type != DrawType::FILL_BLURRED && draw_type != DrawType::FILL_WITHOUT_BLUR) && rs.line_alpha != 0)
-                            ){
+        const bool dot_square = rs.line_width == 1,
+            use_sprites = geometry.points && dot_size > 0 && this->dot_phases > 0 && (dot_square ?
+                matrix.xy == 0 && matrix.yx == 0 && std::abs(matrix.xx) == std::abs(matrix.yy) :
+                std::abs(matrix.xy * matrix.xy + matrix.yy * matrix.yy - dot_scale * dot_scale) <= 1e-9 * dot_scale * dot_scale &&
+                std::abs(matrix.xx * matrix.xy + matrix.yx * matrix.yy) <= 1e-9 * dot_scale * dot_scale) && dots_apart();
 #pragma GCC diagnostic pop
-                                // Transfer shifted path & matrix from buffer to image
-                                cairo_translate(image, -x + border_h, -y + border_v);
-                                cairo_path_t* path = cairo_copy_path(this->stencil_path_buffer);
-                                cairo_append_path(image, path);
-                                cairo_path_destroy(path);
-                                cairo_transform(image, &matrix);
-                                // Set line properties
-                                if(draw_type == DrawType::BORDER || draw_type == DrawType::WIRE){
-                                    if(frame_scale_x > 0)
-                                        set_line_props(image, rs, (frame_scale_x + frame_scale_y) / 2);
-                                    else
-                                        set_line_props(image, rs);
-                                }
-                                // Draw colored geometry on image
-                                if(draw_type == DrawType::FILL_BLURRED || draw_type == DrawType::FILL_WITHOUT_BLUR){
-                                    // Draw color
+        auto stamp_dots = [&](cairo_surface_t* mask, int mask_x, int mask_y){
+            // Sprites by subpixel phase (dot placed at phase offset)
+            const int sprite_phases = this->dot_phases, sprite_size = ceil(dot_size) + 2;
+            std::vector<CairoImage> sprites(sprite_phases * sprite_phases);
+            std::vector<bool> sprites_valid(sprite_phases * sprite_phases, false);
+            // Stamp sprites on coverage mask (dots are apart, union just guards rounding at shared border pixels: a + b - a*b)
+            const int mask_width = cairo_image_surface_get_width(mask), mask_height = cairo_image_surface_get_height(mask),
+                mask_stride = cairo_image_surface_get_stride(mask);
+            cairo_surface_flush(mask);
+            unsigned char* mask_data = cairo_image_surface_get_data(mask);
+            for(const Point& point : *geometry.points){
+                // Split dot origin into pixel position + quantized subpixel phase
+                double center_x = point.x, center_y = point.y;
+                cairo_matrix_transform_point(&matrix, &center_x, &center_y);
+                const double dot_x = center_x - dot_size / 2 - mask_x, dot_y = center_y - dot_size / 2 - mask_y;
+                int sprite_x = floor(dot_x), sprite_y = floor(dot_y),
+                    phase_x = floor((dot_x - sprite_x) * sprite_phases + 0.5),
+                    phase_y = floor((dot_y - sprite_y) * sprite_phases + 0.5);
+                sprite_x += phase_x / sprite_phases,
+                sprite_y += phase_y / sprite_phases;
+                phase_x %= sprite_phases,
+                phase_y %= sprite_phases;
+                if(sprite_x >= mask_width || sprite_y >= mask_height || sprite_x + sprite_size <= 0 || sprite_y + sprite_size <= 0)
+                    continue;
+                // Get sprite (from cache or new rasterized)
+                const int sprite_i = phase_y * sprite_phases + phase_x;
+                if(!sprites_valid[sprite_i]){
+                    const Renderer::SpriteKey sprite_key = {dot_size, dot_square, rs.aa, phase_x, phase_y};
+                    if(this->sprite_cache.contains(sprite_key))
+                        sprites[sprite_i] = this->sprite_cache.get(sprite_key);
+                    else{
+                        CairoImage sprite(sprite_size, sprite_size, CAIRO_FORMAT_A8);
+                        cairo_set_antialias(sprite, rs.aa);
+                        cairo_set_source_rgba(sprite, 1, 1, 1, 1);
+                        const double offset_x = static_cast<double>(phase_x) / sprite_phases,
+                            offset_y = static_cast<double>(phase_y) / sprite_phases;
+                        if(dot_square)
+                            cairo_rectangle(sprite, offset_x, offset_y, dot_size, dot_size);
+                        else
+                            cairo_arc(sprite, offset_x + dot_size / 2, offset_y + dot_size / 2, dot_size / 2, 0, M_PI * 2);
+                        cairo_fill(sprite);
+                        cairo_surface_flush(sprite);
+                        this->sprite_cache.add(sprite_key, sprite);
+                        sprites[sprite_i] = sprite;
+                    }
+                    sprites_valid[sprite_i] = true;
+                }
+                // Stamp sprite (clipped to mask)
+                const unsigned char* sprite_data = cairo_image_surface_get_data(sprites[sprite_i]);
+                const int sprite_stride = cairo_image_surface_get_stride(sprites[sprite_i]),
+                    x_begin = std::max(0, -sprite_x), x_end = std::min(sprite_size, mask_width - sprite_x),
+                    y_end = std::min(sprite_size, mask_height - sprite_y);
+                for(int y = std::max(0, -sprite_y); y < y_end; ++y){
+                    const unsigned char* src = sprite_data + y * sprite_stride;
+                    unsigned char* dst = mask_data + (sprite_y + y) * mask_stride + sprite_x;
+                    for(int x = x_begin; x < x_end; ++x)
+                        dst[x] = dst[x] + src[x] - (dst[x] * src[x] + 127) / 255;
+                }
+            }
+            cairo_surface_mark_dirty(mask);
+        };
+        // Filling of one color (else gradient over geometry area)?
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wfloat-equal"
+        const bool fill_uniform = std::all_of(rs.colors, rs.colors+4, [&rs](RGB& color){return color == rs.colors[0];}) &&
+            std::all_of(rs.alphas, rs.alphas+4, [&rs](double& alpha){return alpha == rs.alphas[0];});
+#pragma GCC diagnostic pop
+        // Set filling color as source (white coverage for gradient, see shade_fill)
+        auto set_fill_source = [&](cairo_t* ctx){
+            if(fill_uniform)
+                cairo_set_source_rgba(ctx, rs.colors[0].r, rs.colors[0].g, rs.colors[0].b, rs.alphas[0]);
+            else
+                cairo_set_source_rgba(ctx, 1, 1, 1, 1);
+        };
+        // Replace white filling coverage of image by gradient (in geometry space by current matrix)
+        auto shade_fill = [&](cairo_t* ctx){
+            if(!fill_uniform){
+                cairo_matrix_t ctx_matrix; cairo_get_matrix(ctx, &ctx_matrix);
+#pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wnarrowing"
-                                    if(std::all_of(rs.colors, rs.colors+4, [&rs](RGB& color){return color == rs.colors[0];}) &&
-                                       std::all_of(rs.alphas, rs.alphas+4, [&rs](double& alpha){return alpha == rs.alphas[0];}))
-                                        cairo_set_source_rgba(image, rs.colors[0].r, rs.colors[0].g, rs.colors[0].b, rs.alphas[0]);
-                                    else if(rs.colors[0] == rs.colors[3] && rs.colors[1] == rs.colors[2] &&
-                                            rs.alphas[0] == rs.alphas[3] && rs.alphas[1] == rs.alphas[2])
-                                        cairo_set_source(image, cairo_pattern_create_linear_color(fill_x, 0, fill_x + fill_width, 0,
-                                                                                                rs.colors[0].r, rs.colors[0].g, rs.colors[0].b, rs.alphas[0],
-                                                                                                rs.colors[1].r, rs.colors[1].g, rs.colors[1].b, rs.alphas[1]));
-                                    else
-                                        cairo_set_source(image, cairo_pattern_create_rect_color({fill_x, fill_y, fill_width, fill_height},
-                                                                                                rs.colors[0].r, rs.colors[0].g, rs.colors[0].b, rs.alphas[0],
-                                                                                                rs.colors[1].r, rs.colors[1].g, rs.colors[1].b, rs.alphas[1],
-                                                                                                rs.colors[2].r, rs.colors[2].g, rs.colors[2].b, rs.alphas[2],
-                                                                                                rs.colors[3].r, rs.colors[3].g, rs.colors[3].b, rs.alphas[3]));
+                cairo_image_surface_rect_color(cairo_get_target(ctx), &ctx_matrix, {fill_x, fill_y, fill_width, fill_height},
+                                               rs.colors[0].r, rs.colors[0].g, rs.colors[0].b, rs.alphas[0],
+                                               rs.colors[1].r, rs.colors[1].g, rs.colors[1].b, rs.alphas[1],
+                                               rs.colors[2].r, rs.colors[2].g, rs.colors[2].b, rs.alphas[2],
+                                               rs.colors[3].r, rs.colors[3].g, rs.colors[3].b, rs.alphas[3]);
 #pragma GCC diagnostic pop
-                                    cairo_fill_preserve(image);
-                                    // Draw texture
-                                    if(!rs.texture.empty()){
-                                        CairoImage texture(rs.texture);
-                                        if(cairo_surface_status(texture) == CAIRO_STATUS_SUCCESS){
-                                            // Create texture pattern
-                                            cairo_matrix_t pattern_matrix = {1, 0, 0, 1, -fill_x - rs.texture_x, -fill_y - rs.texture_y};
-                                            cairo_pattern_t* pattern = cairo_pattern_create_for_surface(texture);
-                                            cairo_pattern_set_matrix(pattern, &pattern_matrix);
-                                            cairo_pattern_set_extend(pattern, rs.wrap_style);
-                                            cairo_pattern_set_filter(pattern, CAIRO_FILTER_BEST);
-                                            // Draw texture pattern on texture image
-                                            CairoImage tex_image(cairo_image_surface_get_width(image), cairo_image_surface_get_height(image), CAIRO_FORMAT_ARGB32);
-                                            cairo_copy_matrix(image, tex_image);
-                                            cairo_set_source(tex_image, pattern);
-                                            cairo_set_operator(tex_image, CAIRO_OPERATOR_SOURCE);
-                                            cairo_paint(tex_image);
-                                            // Multiply texture image to overlay image
-                                            int width = cairo_image_surface_get_width(image);
-                                            int height = cairo_image_surface_get_height(image);
-                                            int offset = cairo_image_surface_get_stride(image) - (width << 2);
-                                            cairo_surface_flush(image);
-                                            cairo_surface_flush(tex_image);
-                                            unsigned char* img_data = cairo_image_surface_get_data(image);
-                                            unsigned char* tex_data = cairo_image_surface_get_data(tex_image);
-                                            unsigned char new_alpha;
-                                            for(int y = 0; y < height; ++y){
-                                                for(int x = 0; x < width; ++x){
-                                                    if(img_data[3] == 0 || tex_data[3] == 0)
-                                                        img_data[0] = img_data[1] = img_data[2] = img_data[3] = 0;
-                                                    else if(img_data[3] == 255 && tex_data[3] == 255){
-                                                        img_data[0] = img_data[0] * tex_data[0] / 255;
-                                                        img_data[1] = img_data[1] * tex_data[1] / 255;
-                                                        img_data[2] = img_data[2] * tex_data[2] / 255;
-                                                    }else{
-                                                        new_alpha = img_data[3] * tex_data[3] / 255;
-                                                        img_data[0] = (img_data[0] * 255 / img_data[3]) * (tex_data[0] * 255 / tex_data[3]) * new_alpha / 65025;
-                                                        img_data[1] = (img_data[1] * 255 / img_data[3]) * (tex_data[1] * 255 / tex_data[3]) * new_alpha / 65025;
-                                                        img_data[2] = (img_data[2] * 255 / img_data[3]) * (tex_data[2] * 255 / tex_data[3]) * new_alpha / 65025;
-                                                        img_data[3] = new_alpha;
-                                                    }
-                                                    img_data += 4;
-                                                    tex_data += 4;
-                                                }
-                                                img_data += offset;
-                                                tex_data += offset;
-                                            }
-                                            cairo_surface_mark_dirty(image);
-                                        }
-                                    }
-                                    // Draw karaoke
-                                    if(rs.karaoke_start >= 0){
-                                        int elapsed_time = start_ms - event.start_ms;
-                                        cairo_set_operator(image, CAIRO_OPERATOR_ATOP);
-                                        switch(rs.karaoke_mode){
-                                            case SSBKaraokeMode::Mode::FILL:
-                                            case SSBKaraokeMode::Mode::SOLID:
-                                                cairo_set_source_rgb(image, rs.karaoke_color.r, rs.karaoke_color.g, rs.karaoke_color.b);
-                                                if(elapsed_time >= rs.karaoke_start + rs.karaoke_duration)
-                                                    cairo_paint(image);
-                                                else if(elapsed_time >= rs.karaoke_start){
-                                                    if(rs.karaoke_mode == SSBKaraokeMode::Mode::SOLID)
-                                                        cairo_paint(image);
-                                                    else{
-                                                        double progress = static_cast<double>(elapsed_time - rs.karaoke_start) / rs.karaoke_duration;
-                                                        cairo_new_path(image);
-                                                        switch(rs.direction){
-                                                            case SSBDirection::Mode::LTR: cairo_rectangle(image, fill_x, fill_y, progress * fill_width, fill_height); break;
-                                                            case SSBDirection::Mode::RTL: cairo_rectangle(image, fill_x + (1 - progress) * fill_width, fill_y, progress * fill_width, fill_height); break;
-                                                            case SSBDirection::Mode::TTB: cairo_rectangle(image, fill_x, fill_y, fill_width, progress * fill_height); break;
-                                                        }
-                                                        cairo_fill(image);
-                                                    }
-                                                }
-                                                break;
-                                            case SSBKaraokeMode::Mode::GLOW:
-                                                if(elapsed_time >= rs.karaoke_start && elapsed_time < rs.karaoke_start + rs.karaoke_duration){
-                                                    cairo_set_source_rgba(image, rs.karaoke_color.r, rs.karaoke_color.g, rs.karaoke_color.b, std::sin(static_cast<double>(elapsed_time - rs.karaoke_start) / rs.karaoke_duration * M_PI));
-                                                    cairo_paint(image);
-                                                }
-                                                break;
-                                        }
-                                    }
-                                }else{  // draw_type == DrawType::BORDER || draw_type == DrawType::WIRE || draw_type == DrawType::BOX
-                                    // Draw color
-                                    cairo_set_source_rgba(image, rs.line_color.r, rs.line_color.g, rs.line_color.b, rs.line_alpha);
-                                    cairo_save(image);
-                                    cairo_identity_matrix(image);
-                                    if(draw_type == DrawType::BOX){
-                                        double x1, y1, x2, y2;
-                                        cairo_fill_extents(image, &x1, &y1, &x2, &y2);
-                                        double box_border = cairo_get_line_width(this->stencil_path_buffer) / 2;
-                                        cairo_path_t* path = cairo_copy_path(image);
+            }
+        };
+        // Geometry parts (border by mode or line width, points have no border)
+        const bool has_border = rs.mode == SSBMode::Mode::WIRE || (rs.line_width > 0 && geometry.type != SSBGeometry::Type::POINTS),
+            has_fill = rs.mode != SSBMode::Mode::WIRE;
+        // Colorize coverage mask just where equal to drawing with color: one color, no texture, no blur, no filling erased from border
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+        const bool use_mask = use_masks && fill_uniform && rs.texture.empty() && rs.blur_h == 0 && rs.blur_v == 0 && !(has_border && has_fill);
+#pragma GCC diagnostic pop
+        // Karaoke state (unhighlighted + highlighted rasters equal timed drawing, in-progress fills + glows get split before blur by timed drawing)
+        enum class KaraokeRaster{TIMED, BASE, HIGHLIGHT} karaoke_raster = KaraokeRaster::TIMED;
+        const long int karaoke_elapsed = static_cast<long int>(start_ms - event.start_ms) - rs.karaoke_start;
+        KaraokeRaster karaoke_state = KaraokeRaster::TIMED;
+        switch(rs.karaoke_mode){
+            case SSBKaraokeMode::Mode::FILL:
+                karaoke_state = karaoke_elapsed < 0 ? KaraokeRaster::BASE : (karaoke_elapsed >= rs.karaoke_duration ? KaraokeRaster::HIGHLIGHT : KaraokeRaster::TIMED);
+                break;
+            case SSBKaraokeMode::Mode::SOLID:
+                karaoke_state = karaoke_elapsed < 0 ? KaraokeRaster::BASE : KaraokeRaster::HIGHLIGHT;
+                break;
+            case SSBKaraokeMode::Mode::GLOW:
+                karaoke_state = karaoke_elapsed < 0 || karaoke_elapsed >= rs.karaoke_duration ? KaraokeRaster::BASE : KaraokeRaster::TIMED;
+                break;
+        }
+        const bool use_karaoke = use_karaokes && rs.karaoke_start >= 0 && rs.stencil_mode == SSBStencil::Mode::OFF && karaoke_state != KaraokeRaster::TIMED;
+        // Area to clip overlays to (phase rasters, masks + karaoke rasters are unclipped, so every position + region can reuse them)
+        Renderer::Rect clip = region;
+        if(use_phase)
+            clip = {x - reach_h, y - reach_v, width + (reach_h << 1), height + (reach_v << 1)};
+        else if(use_mask || use_karaoke)
+            clip = {0, 0, target.width, target.height};
+        // Create overlay by type (as colored image or as coverage mask; karaoke by time or as fixed raster)
+        enum class DrawType{FILL_BLURRED, FILL_WITHOUT_BLUR, BORDER, BOX, WIRE};
+        auto create_overlay = [&](DrawType draw_type, bool coverage) -> Renderer::ImageData{
+            /*
+                CODE FOR PERFORMANCE TESTING ON WINDOWS
+
+                LARGE_INTEGER freq, t1, t2;
+                QueryPerformanceFrequency(&freq);
+                QueryPerformanceCounter(&t1);
+                // INSERT CODE
+                QueryPerformanceCounter(&t2);
+                std::ostringstream s;
+                s << "Duration: " << (static_cast<double>(t2.QuadPart - t1.QuadPart) / freq.QuadPart * 1000) << "ms";
+                MessageBoxA(NULL, s.str().c_str(), "Performance", MB_OK);
+            */
+            // Create image
+            int border_h = 0, border_v = 0;
+            switch(draw_type){
+                case DrawType::WIRE:
+                case DrawType::BORDER:
+                case DrawType::BOX:
+                    border_h = ceil(rs.blur_h) + ceil(line_width / 2),
+                    border_v = ceil(rs.blur_v) + ceil(line_width / 2);
+                    break;
+                case DrawType::FILL_BLURRED:
+                    border_h = ceil(rs.blur_h),
+                    border_v = ceil(rs.blur_v);
+                    break;
+                case DrawType::FILL_WITHOUT_BLUR:
+                    // Border already with zero initialized
+                    break;
+            }
+            // Clip image to render region (+ blur reach, so region pixels get the same blur result)
+            int blur_reach_h = draw_type == DrawType::FILL_WITHOUT_BLUR ? 0 : ceil(rs.blur_h),
+                blur_reach_v = draw_type == DrawType::FILL_WITHOUT_BLUR ? 0 : ceil(rs.blur_v),
+                image_x = std::max(x - border_h, clip.x - blur_reach_h),
+                image_y = std::max(y - border_v, clip.y - blur_reach_v),
+                image_width = std::max(std::min(x + width + border_h, clip.x + clip.width + blur_reach_h) - image_x, 0),
+                image_height = std::max(std::min(y + height + border_v, clip.y + clip.height + blur_reach_v) - image_y, 0);
+            CairoImage image(image_width, image_height, coverage ? CAIRO_FORMAT_A8 : CAIRO_FORMAT_ARGB32);
+            cairo_set_antialias(image, rs.aa);
+            // Anything visible?
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+            if(image_width > 0 && image_height > 0 && (coverage ||
+                ((draw_type == DrawType::FILL_BLURRED || draw_type == DrawType::FILL_WITHOUT_BLUR) && !std::all_of(rs.alphas, rs.alphas+4, [](double& a){return a == 0.0;})) ||
+                ((draw_type != DrawType::FILL_BLURRED && draw_type != DrawType::FILL_WITHOUT_BLUR) && rs.line_alpha != 0)
+            )){
+#pragma GCC diagnostic pop
+                // Add shifted path & matrix to image (stamped points need no path)
+                const bool stamp = use_sprites && (draw_type == DrawType::FILL_BLURRED || draw_type == DrawType::FILL_WITHOUT_BLUR);
+                cairo_translate(image, -image_x, -image_y);
+                if(!stamp)
+                    path.to_cairo(image);
+                cairo_transform(image, &matrix);
+                // Set line properties
+                if(draw_type == DrawType::BORDER || draw_type == DrawType::WIRE){
+                    if(frame_scale_x > 0)
+                        set_line_props(image, rs, (frame_scale_x + frame_scale_y) / 2);
+                    else
+                        set_line_props(image, rs);
+                }
+                // Draw colored geometry on image
+                if(draw_type == DrawType::FILL_BLURRED || draw_type == DrawType::FILL_WITHOUT_BLUR){
+                    // Draw color
+                    if(coverage)
+                        cairo_set_source_rgba(image, 1, 1, 1, 1);
+                    else
+                        set_fill_source(image);
+                    if(stamp){
+                        CairoImage mask(image_width, image_height, CAIRO_FORMAT_A8);
+                        stamp_dots(mask, image_x, image_y);
+                        cairo_save(image);
+                        cairo_identity_matrix(image);
+                        cairo_mask_surface(image, mask, 0, 0);
+                        cairo_restore(image);
+                    }else if(this->scanline_rasterizer)
+                        cairo_fill_scanline_preserve(image);
+                    else
+                        cairo_fill_preserve(image);
+                    if(!coverage)
+                        shade_fill(image);
+                    // Draw texture
+                    if(!coverage && !rs.texture.empty()){
+                        // Get image-to-texture matrix (texture placed in geometry space)
+                        cairo_matrix_t tex_matrix, pattern_matrix = {1, 0, 0, 1, -fill_x - rs.texture_x, -fill_y - rs.texture_y};
+                        cairo_get_matrix(image, &tex_matrix);
+                        if(cairo_matrix_invert(&tex_matrix) == CAIRO_STATUS_SUCCESS){
+                            cairo_matrix_multiply(&tex_matrix, &tex_matrix, &pattern_matrix);
+                            // Select mip level by texels per pixel (minified textures get pre-scaled; levels beyond 1x1 size are limited anyway)
+                            const double texels_per_pixel = std::max(std::hypot(tex_matrix.xx, tex_matrix.yx), std::hypot(tex_matrix.xy, tex_matrix.yy));
+                            const unsigned int mip_level = texels_per_pixel >= 2 ? std::min(std::log2(texels_per_pixel), 31.0) : 0;
+                            cairo_matrix_t level_matrix;
+                            CairoImage texture(rs.texture, script_dir, mip_level, &level_matrix);
+                            if(cairo_surface_status(texture) == CAIRO_STATUS_SUCCESS){
+                                cairo_matrix_multiply(&tex_matrix, &tex_matrix, &level_matrix);
+                                // Multiply texture to covered pixels of overlay image
+                                cairo_image_surface_modulate(image, texture, &tex_matrix, rs.wrap_style);
+                            }
+                        }
+                    }
+                    // Draw karaoke
+                    if(!coverage && rs.karaoke_start >= 0 && karaoke_raster == KaraokeRaster::HIGHLIGHT){
+                        cairo_set_operator(image, CAIRO_OPERATOR_ATOP);
+                        cairo_set_source_rgb(image, rs.karaoke_color.r, rs.karaoke_color.g, rs.karaoke_color.b);
+                        cairo_paint(image);
+                    }else if(!coverage && rs.karaoke_start >= 0 && karaoke_raster == KaraokeRaster::TIMED){
+                        int elapsed_time = start_ms - event.start_ms;
+                        cairo_set_operator(image, CAIRO_OPERATOR_ATOP);
+                        switch(rs.karaoke_mode){
+                            case SSBKaraokeMode::Mode::FILL:
+                            case SSBKaraokeMode::Mode::SOLID:
+                                cairo_set_source_rgb(image, rs.karaoke_color.r, rs.karaoke_color.g, rs.karaoke_color.b);
+                                if(elapsed_time >= rs.karaoke_start + rs.karaoke_duration)
+                                    cairo_paint(image);
+                                else if(elapsed_time >= rs.karaoke_start){
+                                    if(rs.karaoke_mode == SSBKaraokeMode::Mode::SOLID)
+                                        cairo_paint(image);
+                                    else{
+                                        double progress = static_cast<double>(elapsed_time - rs.karaoke_start) / rs.karaoke_duration;
                                         cairo_new_path(image);
-                                        cairo_rectangle(image, x1-box_border, y1-box_border, x2-x1+box_border*2, y2-y1+box_border*2);
+                                        switch(rs.direction){
+                                            case SSBDirection::Mode::LTR: cairo_rectangle(image, fill_x, fill_y, progress * fill_width, fill_height); break;
+                                            case SSBDirection::Mode::RTL: cairo_rectangle(image, fill_x + (1 - progress) * fill_width, fill_y, progress * fill_width, fill_height); break;
+                                            case SSBDirection::Mode::TTB: cairo_rectangle(image, fill_x, fill_y, fill_width, progress * fill_height); break;
+                                        }
                                         cairo_fill(image);
-                                        cairo_append_path(image, path);
-                                        cairo_path_destroy(path);
-                                    }else   // draw_type == DrawType::BORDER || draw_type == DrawType::WIRE
-                                        cairo_stroke_preserve(image);
-                                    cairo_restore(image);
-                                }
-                                // Blur image
-                                if(draw_type != DrawType::FILL_WITHOUT_BLUR)
-                                    cairo_image_surface_blur(image, rs.blur_h, rs.blur_v);
-                                // Erase filling in stroke/box -> create border
-                                if(draw_type == DrawType::BORDER || draw_type == DrawType::BOX){
-                                    cairo_set_source_rgba(image, 0, 0, 0, 1);
-                                    cairo_set_operator(image, CAIRO_OPERATOR_DEST_OUT);
-                                    cairo_fill(image);
+                                    }
                                 }
-                            }
-                            // Return complete overlay data
-                            return {image, -border_h + x, -border_v + y, rs.blend_mode, rs.fade_in, rs.fade_out};
-                        };
-                        // Create overlay
-                        Renderer::ImageData overlay;
-                        if(rs.mode == SSBMode::Mode::FILL || rs.mode == SSBMode::Mode::BOXED){
-                            if(rs.line_width > 0 && geometry->type != SSBGeometry::Type::POINTS){
-                                std::function<void()> create_overlay_wrapper = [&overlay,&create_overlay,&rs]() -> void{
-                                    overlay = create_overlay(rs.mode == SSBMode::Mode::FILL ? DrawType::BORDER : DrawType::BOX);
-                                };
-                                nthread_t thread = nthread_create(call_in_thread, &create_overlay_wrapper);
-                                Renderer::ImageData overlay2 = create_overlay(DrawType::FILL_WITHOUT_BLUR);
-                                nthread_join(thread);
-                                nthread_destroy(thread);
-                                cairo_set_operator(overlay.image, CAIRO_OPERATOR_ADD);
-                                cairo_identity_matrix(overlay.image);
-                                cairo_set_source_surface(overlay.image, overlay2.image, overlay2.x - overlay.x, overlay2.y - overlay.y);
-                                cairo_paint(overlay.image);
-                            }else
-                                overlay = create_overlay(DrawType::FILL_BLURRED);
-                        }else   // rs.mode == SSBMode::Mode::WIRE
-                            overlay = create_overlay(DrawType::WIRE);
-                        // Apply stenciling and/or blending on frame
-                        switch(rs.stencil_mode){
-                            case SSBStencil::Mode::OFF:
-                                this->blend(create_faded_image(overlay.image, overlay.fade_in, overlay.fade_out, start_ms, event.start_ms, event.end_ms),
-                                            overlay.x, overlay.y, frame, pitch, overlay.blend_mode);
-                                if(event.static_tags)
-                                    event_images.push_back(overlay);
                                 break;
-                            case SSBStencil::Mode::INSIDE:
-                                cairo_set_operator(overlay.image, CAIRO_OPERATOR_DEST_IN);
-                                cairo_identity_matrix(overlay.image);
-                                cairo_set_source_surface(overlay.image, this->stencil_path_buffer, -overlay.x, -overlay.y);
-                                cairo_paint(overlay.image);
-                                this->blend(create_faded_image(overlay.image, overlay.fade_in, overlay.fade_out, start_ms, event.start_ms, event.end_ms),
-                                            overlay.x, overlay.y, frame, pitch, overlay.blend_mode);
-                                if(event.static_tags)
-                                    event_images.push_back(overlay);
-                                break;
-                            case SSBStencil::Mode::OUTSIDE:
-                                cairo_set_operator(overlay.image, CAIRO_OPERATOR_DEST_OUT);
-                                cairo_identity_matrix(overlay.image);
-                                cairo_set_source_surface(overlay.image, this->stencil_path_buffer, -overlay.x, -overlay.y);
-                                cairo_paint(overlay.image);
-                                this->blend(create_faded_image(overlay.image, overlay.fade_in, overlay.fade_out, start_ms, event.start_ms, event.end_ms),
-                                            overlay.x, overlay.y, frame, pitch, overlay.blend_mode);
-                                if(event.static_tags)
-                                    event_images.push_back(overlay);
-                                break;
-                            case SSBStencil::Mode::SET:
-                                cairo_set_operator(this->stencil_path_buffer, CAIRO_OPERATOR_ADD);
-                                cairo_set_source_surface(this->stencil_path_buffer, overlay.image, overlay.x, overlay.y);
-                                cairo_paint(this->stencil_path_buffer);
-                                break;
-                            case SSBStencil::Mode::UNSET:
-                                // Invert alpha
-                                cairo_set_operator(overlay.image, CAIRO_OPERATOR_XOR);
-                                cairo_set_source_rgba(overlay.image, 1, 1, 1, 1);
-                                cairo_paint(overlay.image);
-                                // Multiply alpha
-                                cairo_set_operator(this->stencil_path_buffer, CAIRO_OPERATOR_IN);
-                                cairo_set_source_surface(this->stencil_path_buffer, overlay.image, overlay.x, overlay.y);
-                                cairo_paint(this->stencil_path_buffer);
+                            case SSBKaraokeMode::Mode::GLOW:
+                                if(elapsed_time >= rs.karaoke_start && elapsed_time < rs.karaoke_start + rs.karaoke_duration){
+                                    cairo_set_source_rgba(image, rs.karaoke_color.r, rs.karaoke_color.g, rs.karaoke_color.b, std::sin(static_cast<double>(elapsed_time - rs.karaoke_start) / rs.karaoke_duration * M_PI));
+                                    cairo_paint(image);
+                                }
                                 break;
                         }
-                        // Clear path
-                        cairo_new_path(this->stencil_path_buffer);
                     }
-                // Clear stencil (on modification)
-                if(cairo_get_operator(this->stencil_path_buffer) != CAIRO_OPERATOR_SOURCE){
-                    cairo_set_operator(this->stencil_path_buffer, CAIRO_OPERATOR_SOURCE);
-                    cairo_set_source_rgba(this->stencil_path_buffer, 0, 0, 0, 0);
-                    cairo_paint(this->stencil_path_buffer);
+                }else{  // draw_type == DrawType::BORDER || draw_type == DrawType::WIRE || draw_type == DrawType::BOX
+                    // Draw color
+                    if(coverage)
+                        cairo_set_source_rgba(image, 1, 1, 1, 1);
+                    else
+                        cairo_set_source_rgba(image, rs.line_color.r, rs.line_color.g, rs.line_color.b, rs.line_alpha);
+                    cairo_save(image);
+                    cairo_identity_matrix(image);
+                    if(draw_type == DrawType::BOX){
+                        double x1, y1, x2, y2;
+                        cairo_fill_extents(image, &x1, &y1, &x2, &y2);
+                        double box_border = line_width / 2;
+                        cairo_new_path(image);
+                        cairo_rectangle(image, x1-box_border, y1-box_border, x2-x1+box_border*2, y2-y1+box_border*2);
+                        cairo_fill(image);
+                        cairo_translate(image, -image_x, -image_y);
+                        path.to_cairo(image);
+                    }else if(draw_type == DrawType::BORDER && rs.line_join == CAIRO_LINE_JOIN_ROUND && rs.dashes.empty() && cairo_get_line_width(image) >= 8 && geometry.path->closed())
+                        // Thick round borders of closed geometries by dilated filling (cheaper than stroking; open ends would lose caps + get closed)
+                        cairo_stroke_distance_preserve(image);
+                    else   // draw_type == DrawType::BORDER || draw_type == DrawType::WIRE
+                        cairo_stroke_preserve(image);
+                    cairo_restore(image);
+                }
+                // Blur image
+                if(draw_type != DrawType::FILL_WITHOUT_BLUR)
+                    cairo_image_surface_blur(image, rs.blur_h, rs.blur_v);
+                // Erase filling in stroke/box -> create border
+                if(draw_type == DrawType::BORDER || draw_type == DrawType::BOX){
+                    cairo_set_source_rgba(image, 0, 0, 0, 1);
+                    cairo_set_operator(image, CAIRO_OPERATOR_DEST_OUT);
+                    cairo_fill(image);
                 }
-                // Save event images to cache
-                if(!event_images.empty())
-                    this->cache.add(&event, event_images);
             }
-        }
+            // Return complete overlay data
+            return {image, image_x, image_y, rs.blend_mode, rs.fade_in, rs.fade_out, {0, 0, 0, 0}, nullptr};
+        };
+        // Geometry visible in render region (image with maximal border intersects region)?
+        if(x + shift_x - reach_h < region.x + region.width && y + shift_y - reach_v < region.y + region.height &&
+           x + shift_x + width + reach_h > region.x && y + shift_y + height + reach_v > region.y){
+            // Create border and/or filling images by mode (border + filling in parallel)
+            auto create_images = [&](bool coverage, Renderer::ImageData& border, Renderer::ImageData& fill){
+                if(rs.mode == SSBMode::Mode::FILL || rs.mode == SSBMode::Mode::BOXED){
+                    if(rs.line_width > 0 && geometry.type != SSBGeometry::Type::POINTS){
+                        std::function<void()> create_overlay_wrapper = [&border,&create_overlay,&rs,&coverage]() -> void{
+                            border = create_overlay(rs.mode == SSBMode::Mode::FILL ? DrawType::BORDER : DrawType::BOX, coverage);
+                        };
+                        nthread_t thread = nthread_create(call_in_thread, &create_overlay_wrapper);
+                        fill = create_overlay(DrawType::FILL_WITHOUT_BLUR, coverage);
+                        nthread_join(thread);
+                        nthread_destroy(thread);
+                    }else
+                        fill = create_overlay(DrawType::FILL_BLURRED, coverage);
+                }else   // rs.mode == SSBMode::Mode::WIRE
+                    border = create_overlay(DrawType::WIRE, coverage);
+            };
+            // Content of unstenciled geometries, unclipped by region, addresses rasters shared by all events
+            const int pixel_x = floor(matrix.x0), pixel_y = floor(matrix.y0);
+            const bool use_raster = !use_phase && !use_karaoke && rs.stencil_mode == SSBStencil::Mode::OFF &&
+                x - reach_h >= region.x && y - reach_v >= region.y && x + width + reach_h <= region.x + region.width && y + height + reach_v <= region.y + region.height;
+            unsigned long long int raster_hash = 14695981039346656037ULL;
+            if(use_raster){
+                hash_value(raster_hash, geometry.type);
+                hash_path(raster_hash, *geometry.path);
+                const double matrix_values[] = {matrix.xx, matrix.yx, matrix.xy, matrix.yy, matrix.x0 - pixel_x, matrix.y0 - pixel_y};
+                hash_value(raster_hash, matrix_values);
+                hash_value(raster_hash, rs.mode);
+                hash_value(raster_hash, rs.line_width);
+                hash_value(raster_hash, rs.line_join);
+                hash_value(raster_hash, rs.line_cap);
+                hash_data(raster_hash, rs.dashes.data(), rs.dashes.size() * sizeof(double));
+                hash_value(raster_hash, rs.dash_offset);
+                hash_value(raster_hash, frame_scale_x);
+                hash_value(raster_hash, frame_scale_y);
+                hash_value(raster_hash, rs.colors);
+                hash_value(raster_hash, rs.alphas);
+                hash_value(raster_hash, rs.line_color);
+                hash_value(raster_hash, rs.line_alpha);
+                hash_data(raster_hash, rs.texture.data(), rs.texture.size());
+                if(!rs.texture.empty())
+                    hash_data(raster_hash, script_dir.data(), script_dir.size());
+                hash_value(raster_hash, rs.texture_x);
+                hash_value(raster_hash, rs.texture_y);
+                hash_value(raster_hash, rs.wrap_style);
+                hash_value(raster_hash, rs.blur_h);
+                hash_value(raster_hash, rs.blur_v);
+                hash_value(raster_hash, rs.aa);
+                // Karaoke by elapsed time in his duration (-1 = before, duration = after)
+                if(rs.karaoke_start >= 0){
+                    const long int karaoke_time = std::max(std::min(static_cast<long int>(start_ms - event.start_ms) - rs.karaoke_start, rs.karaoke_duration), -1L);
+                    hash_value(raster_hash, rs.karaoke_mode);
+                    hash_value(raster_hash, rs.karaoke_color);
+                    hash_value(raster_hash, rs.karaoke_duration);
+                    hash_value(raster_hash, karaoke_time);
+                    hash_value(raster_hash, rs.direction);
+                }
+                ++this->stats.raster_lookups;
+            }
+            // Create overlay
+            Renderer::ImageData overlay;
+            const Renderer::PhaseKey phase_key = {&event, target.width, target.height, geometry_i, phase_x, phase_y};
+            if(use_phase && this->phase_cache.contains(phase_key))
+                overlay = this->phase_cache.get(phase_key);
+            else if(use_karaoke){
+                // Get unhighlighted + highlighted rasters
+                const Renderer::KaraokeKey karaoke_key = {&event, target.width, target.height, geometry_i};
+                Renderer::KaraokeData karaoke;
+                if(this->karaoke_cache.contains(karaoke_key))
+                    karaoke = this->karaoke_cache.get(karaoke_key);
+                else{
+                    for(KaraokeRaster raster : {KaraokeRaster::BASE, KaraokeRaster::HIGHLIGHT}){
+                        karaoke_raster = raster;
+                        Renderer::ImageData border, fill;
+                        create_images(false, border, fill);
+                        if(has_border && has_fill){
+                            cairo_set_operator(border.image, CAIRO_OPERATOR_ADD);
+                            cairo_identity_matrix(border.image);
+                            cairo_set_source_surface(border.image, fill.image, fill.x - border.x, fill.y - border.y);
+                            cairo_paint(border.image);
+                        }
+                        (raster == KaraokeRaster::BASE ? karaoke.base : karaoke.highlight) = has_border ? border : fill;
+                    }
+                    karaoke_raster = KaraokeRaster::TIMED;
+                    this->karaoke_cache.add(karaoke_key, karaoke);
+                }
+                // Select raster of karaoke state
+                overlay = karaoke_state == KaraokeRaster::BASE ? karaoke.base : karaoke.highlight;
+            }
+            else if(use_raster && this->raster_cache.contains(raster_hash)){
+                // Move shared raster to pixel position (with own blending)
+                overlay = this->raster_cache.get(raster_hash);
+                overlay.x += pixel_x,
+                overlay.y += pixel_y,
+                overlay.blend_mode = rs.blend_mode,
+                overlay.fade_in = rs.fade_in,
+                overlay.fade_out = rs.fade_out;
+                ++this->stats.raster_hits;
+            }
+            else if(use_mask){
+                // Get coverage mask (border or filling)
+                if(!masks[geometry_i].valid){
+                    Renderer::ImageData border, fill;
+                    create_images(true, border, fill);
+                    masks[geometry_i] = {true, has_fill, has_border, fill.image, border.image, fill.x, fill.y, border.x, border.y};
+                    masks_changed = true;
+                }
+                Renderer::MaskData& mask = masks[geometry_i];
+                // Colorize mask (painted through coverage like color through path)
+                cairo_surface_t* base_mask = mask.has_border ? mask.border : mask.fill;
+                CairoImage image(cairo_image_surface_get_width(base_mask), cairo_image_surface_get_height(base_mask), CAIRO_FORMAT_ARGB32);
+                if(mask.has_border)
+                    cairo_set_source_rgba(image, rs.line_color.r, rs.line_color.g, rs.line_color.b, rs.line_alpha);
+                else
+                    set_fill_source(image);
+                cairo_mask_surface(image, base_mask, 0, 0);
+                overlay = {image, mask.has_border ? mask.border_x : mask.fill_x, mask.has_border ? mask.border_y : mask.fill_y, rs.blend_mode, rs.fade_in, rs.fade_out, {0, 0, 0, 0}, nullptr};
+            }else{
+                // Draw colored images
+                Renderer::ImageData border, fill;
+                create_images(false, border, fill);
+                if(has_border && has_fill){
+                    cairo_set_operator(border.image, CAIRO_OPERATOR_ADD);
+                    cairo_identity_matrix(border.image);
+                    cairo_set_source_surface(border.image, fill.image, fill.x - border.x, fill.y - border.y);
+                    cairo_paint(border.image);
+                }
+                overlay = has_border ? border : fill;
+                // Save subpixel phase raster to cache
+                if(use_phase)
+                    this->phase_cache.add(phase_key, overlay);
+                // Save raster relative to pixel position to cache
+                else if(use_raster){
+                    Renderer::ImageData raster = {overlay.image, overlay.x - pixel_x, overlay.y - pixel_y, overlay.blend_mode, overlay.fade_in, overlay.fade_out, {0, 0, 0, 0}, nullptr};
+                    this->compact(raster);
+                    this->encode_spans(raster);
+                    this->raster_cache.add(raster_hash, raster);
+                }
+            }
+            // Move phase raster to position
+            overlay.x += shift_x,
+            overlay.y += shift_y;
+            // Apply stenciling and/or blending on frame
+            switch(rs.stencil_mode){
+                case SSBStencil::Mode::OFF:
+                    event_images.push_back(overlay);
+                    break;
+                case SSBStencil::Mode::INSIDE:
+                    // Keep overlay inside stencil area (nothing without stencil)
+                    cairo_set_operator(overlay.image, CAIRO_OPERATOR_DEST_IN);
+                    cairo_identity_matrix(overlay.image);
+                    if(this->stencil_rect.width > 0)
+                        cairo_set_source_surface(overlay.image, this->stencil, this->stencil_rect.x - overlay.x, this->stencil_rect.y - overlay.y);
+                    else
+                        cairo_set_source_rgba(overlay.image, 0, 0, 0, 0);
+                    cairo_paint(overlay.image);
+                    event_images.push_back(overlay);
+                    break;
+                case SSBStencil::Mode::OUTSIDE:
+                    // Remove stencil area from overlay
+                    if(this->stencil_rect.width > 0){
+                        cairo_set_operator(overlay.image, CAIRO_OPERATOR_DEST_OUT);
+                        cairo_identity_matrix(overlay.image);
+                        cairo_set_source_surface(overlay.image, this->stencil, this->stencil_rect.x - overlay.x, this->stencil_rect.y - overlay.y);
+                        cairo_paint(overlay.image);
+                    }
+                    event_images.push_back(overlay);
+                    break;
+                case SSBStencil::Mode::SET:
+                    {
+                        // Grow stencil area by overlay area
+                        Renderer::Rect rect = {overlay.x, overlay.y, cairo_image_surface_get_width(overlay.image), cairo_image_surface_get_height(overlay.image)};
+                        if(this->stencil_rect.width > 0){
+                            const int x2 = std::max(rect.x + rect.width, this->stencil_rect.x + this->stencil_rect.width),
+                                y2 = std::max(rect.y + rect.height, this->stencil_rect.y + this->stencil_rect.height);
+                            rect.x = std::min(rect.x, this->stencil_rect.x),
+                            rect.y = std::min(rect.y, this->stencil_rect.y),
+                            rect.width = x2 - rect.x,
+                            rect.height = y2 - rect.y;
+                        }
+                        if(rect.width > 0 && rect.height > 0){
+                            set_stencil_rect(rect);
+                            // Add overlay alpha
+                            cairo_set_operator(this->stencil, CAIRO_OPERATOR_ADD);
+                            cairo_set_source_surface(this->stencil, overlay.image, overlay.x - rect.x, overlay.y - rect.y);
+                            cairo_paint(this->stencil);
+                        }
+                    }
+                    break;
+                case SSBStencil::Mode::UNSET:
+                    {
+                        // Shrink stencil area to overlay area (multiplication clears the rest)
+                        const int x = std::max(overlay.x, this->stencil_rect.x),
+                            y = std::max(overlay.y, this->stencil_rect.y),
+                            x2 = std::min(overlay.x + cairo_image_surface_get_width(overlay.image), this->stencil_rect.x + this->stencil_rect.width),
+                            y2 = std::min(overlay.y + cairo_image_surface_get_height(overlay.image), this->stencil_rect.y + this->stencil_rect.height);
+                        if(this->stencil_rect.width > 0 && x < x2 && y < y2){
+                            set_stencil_rect({x, y, x2 - x, y2 - y});
+                            // Invert alpha
+                            cairo_set_operator(overlay.image, CAIRO_OPERATOR_XOR);
+                            cairo_set_source_rgba(overlay.image, 1, 1, 1, 1);
+                            cairo_paint(overlay.image);
+                            // Multiply alpha
+                            cairo_set_operator(this->stencil, CAIRO_OPERATOR_IN);
+                            cairo_set_source_surface(this->stencil, overlay.image, overlay.x - x, overlay.y - y);
+                            cairo_paint(this->stencil);
+                        }else
+                            set_stencil_rect({0, 0, 0, 0});
+                    }
+                    break;
+            }
+        }else if(rs.stencil_mode == SSBStencil::Mode::UNSET)
+            // Invisible unsetting still clears stencil in region
+            set_stencil_rect({0, 0, 0, 0});
+    }
+    // Release stencil
+    set_stencil_rect({0, 0, 0, 0});
+    // Save new coverage masks to cache
+    if(masks_changed)
+        this->mask_cache.add(mask_key, masks);
 }
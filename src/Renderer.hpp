@@ -22,32 +22,200 @@ class Renderer{
     public:
         // Supported colorspaces
         enum class Colorspace : char{BGR, BGRX, BGRA};
+        // Frame area (origin at top-left)
+        struct Rect{
+            int x, y, width, height;
+        };
+        // Frame to render on (data + meta informations)
+        struct Target{
+            unsigned char* frame;
+            int pitch, width, height;
+            Colorspace format;
+        };
+        // Cache statistics (dedup ratio = raster hits / raster lookups; texture values count for all renderers)
+        struct Stats{
+            unsigned long int raster_lookups, raster_hits;
+            unsigned long int texture_lookups, texture_hits, texture_decodes;
+            double texture_decode_ms;
+        };
     private:
         // Frame data
         int width, height;
         Colorspace format;
-        // SSB data
-        SSBData ssb;
-        // Path buffer
-        CairoImage stencil_path_buffer;
-        // Event images cache
+        // SSB data of scripts (in stacking order, last on top)
+        std::vector<SSBData> scripts;
+        // Directories of scripts for file loading (parallel to scripts; scripts from memory take the previous one)
+        std::vector<std::string> script_dirs;
+        // Background decodings of script textures
+        std::vector<std::shared_ptr<CairoImagePreload>> preloads;
+        // Path buffer (context for path building)
+        CairoImage path_buffer;
+        // Stencil of current event (allocated on use, covers just the modified area)
+        CairoImage stencil;
+        Rect stencil_rect = {0, 0, 0, 0};
+        // Event images cache (by event + target size + time segment)
+        struct Span{
+            int x, y, width;
+            bool opaque;
+            size_t offset;  // Of pixels in span data
+        };
+        struct SpanData{
+            int width, height;
+            cairo_format_t format;
+            std::vector<Span> spans;   // Non-empty pixel runs (opaque & partial ones separated) by rows
+            std::vector<unsigned char> pixels;
+        };
         struct ImageData{
-            CairoImage image;
+            CairoImage image;   // ARGB32 or A8 coverage of color
             int x, y;
             SSBBlend::Mode blend_mode;
             double fade_in, fade_out;
+            unsigned char color[4]; // Premultiplied BGRA (for A8 image)
+            std::shared_ptr<SpanData> spans;    // Replaces image (for cached images)
+        };
+        struct CacheKey{
+            SSBEvent* event;
+            int width, height;
+            long int segment;
+            bool operator==(const CacheKey& other) const{
+                return this->event == other.event && this->width == other.width && this->height == other.height && this->segment == other.segment;
+            }
+        };
+        Cache<CacheKey,std::vector<ImageData>> cache;
+        // Flattened event images of unchanged active set (by cache keys of last full frame render; overlapping images merged)
+        std::vector<CacheKey> composite_keys;
+        std::vector<ImageData> composite;
+        // Frame rate for time quantization (0 = no quantization)
+        unsigned long int frame_grid_num = 0, frame_grid_den = 0;
+        // Event layouts cache (by event + layout frame size + layout-affecting state), for animated events
+        struct EventLayout;
+        struct LayoutKey{
+            SSBEvent* event;
+            int width, height;
+            unsigned long long int state_hash;
+            bool operator==(const LayoutKey& other) const{
+                return this->event == other.event && this->width == other.width && this->height == other.height && this->state_hash == other.state_hash;
+            }
+        };
+        Cache<LayoutKey,std::shared_ptr<EventLayout>> layout_cache;
+        // Coverage masks cache (by event + target size), for events with just color animations
+        struct MaskData{
+            bool valid, has_fill, has_border;
+            CairoImage fill, border;    // A8
+            int fill_x, fill_y, border_x, border_y;
+        };
+        Cache<CacheKey,std::vector<MaskData>> mask_cache;
+        // Subpixel phase rasters cache (by event + target size + geometry + phase), for events with just translation animations
+        int subpixel_phases = 4;
+        struct PhaseKey{
+            SSBEvent* event;
+            int width, height;
+            size_t geometry;
+            int phase_x, phase_y;
+            bool operator==(const PhaseKey& other) const{
+                return this->event == other.event && this->width == other.width && this->height == other.height &&
+                    this->geometry == other.geometry && this->phase_x == other.phase_x && this->phase_y == other.phase_y;
+            }
+        };
+        Cache<PhaseKey,ImageData> phase_cache{256};
+        // Dot sprites cache (by device size + shape + antialiasing + subpixel phase), for points geometries with dots apart
+        int dot_phases = 16;
+        struct SpriteKey{
+            double size;
+            bool square;
+            cairo_antialias_t aa;
+            int phase_x, phase_y;
+            bool operator==(const SpriteKey& other) const{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+                return this->size == other.size && this->square == other.square && this->aa == other.aa &&
+                    this->phase_x == other.phase_x && this->phase_y == other.phase_y;
+#pragma GCC diagnostic pop
+            }
+        };
+        Cache<SpriteKey,CairoImage> sprite_cache{256};
+        // Fill geometries by internal scanline rasterizer instead of cairo
+        bool scanline_rasterizer = false;
+        // Karaoke rasters cache (by event + target size + geometry), for events with karaoke but without animations
+        struct KaraokeKey{
+            SSBEvent* event;
+            int width, height;
+            size_t geometry;
+            bool operator==(const KaraokeKey& other) const{
+                return this->event == other.event && this->width == other.width && this->height == other.height && this->geometry == other.geometry;
+            }
+        };
+        struct KaraokeData{
+            ImageData base, highlight;
         };
-        Cache<SSBEvent*,std::vector<ImageData>> cache;
-        // Blend image on frame
+        Cache<KaraokeKey,KaraokeData> karaoke_cache{256};
+        // Content-addressed rasters cache (by hash of resolved geometry + render state, relative to pixel position), shared by all events
+        Cache<unsigned long long int,ImageData> raster_cache{256};
+        // Render feedback (modified frame areas + content signature)
+        std::vector<Rect> dirty_rects;
+        unsigned long long int signature = 0;
+        bool signature_valid = false, signature_changed = true;
+        // Cache statistics
+        Stats stats = {0, 0, 0, 0, 0, 0};
+        // Drop all cached images, layouts & rasters (+ signature), for changes of scripts or render state
+        void clear_caches();
+        // Add event state to signature (by event + time segment or render time, not by pixels)
+        void sign(SSBEvent& event, bool cacheable, long int segment, const std::vector<ImageData>& event_images, unsigned long int start_ms);
+        // Blend image (ARGB32 or A8 with color) on target region
         void blend(cairo_surface_t* src, int dst_x, int dst_y,
-                   unsigned char* dst_data, int dst_stride,
-                   SSBBlend::Mode blend_mode);
+                   const Target& target, const Rect& region,
+                   SSBBlend::Mode blend_mode, bool feedback, const unsigned char* color = nullptr);
+        void blend(const SpanData& src, int dst_x, int dst_y,
+                   const Target& target, const Rect& region,
+                   SSBBlend::Mode blend_mode, bool feedback, const unsigned char* color = nullptr);
+        // Blend cached image (with fade) on target region
+        void blend(SSBEvent& event, ImageData& idata, unsigned long int start_ms,
+                   const Target& target, const Rect& region, bool feedback);
+        // Convert image of one color to A8 coverage + color (just if every pixel expands back exactly)
+        void compact(ImageData& idata);
+        // Convert mostly transparent image to non-empty pixel runs (image gets released)
+        void encode_spans(ImageData& idata);
+        // Get image (decoded from pixel runs if necessary)
+        CairoImage decode_spans(const ImageData& idata);
+        // Event geometry with layout, ready for drawing (defined in Renderer.cpp)
+        struct GeometryData;
+        // Layout event geometries for frame size (paths aligned + deformed, not transformed)
+        std::shared_ptr<EventLayout> layout_event(SSBEvent& event, unsigned long int start_ms, int frame_width, int frame_height);
+        // Draw laid out event for target region (images to blend get collected)
+        void draw_event(SSBEvent& event, const SSBFrame& script_frame, const std::string& script_dir, std::vector<GeometryData>& geometries, unsigned long int start_ms,
+                        const Target& target, const Rect& region, std::vector<ImageData>& event_images);
+        // Flatten images blended over (overlapping ones get composited in stacking order, separated ones stay apart; results compacted)
+        // Groups get composited just if no partial pixel covers another one, so blending the result gives the same bytes as blending the images
+        std::vector<ImageData> flatten(const std::vector<ImageData>& images);
+        // Render SSB contents on target regions (feedback refers to first target)
+        void render_targets(const Target* targets, const Rect* regions, size_t targets_n, unsigned long int start_ms);
     public:
-        // Frame meta informations saving + SSB parsing + path buffer creation
+        // Frame meta informations saving + SSB parsing + texture preloading
         Renderer(int width, int height, Colorspace format, std::string& script, bool warnings);
         Renderer(int width, int height, Colorspace format, std::istream& script, bool warnings);
+        // Add SSB script on top of the previous ones
+        void add_script(std::string& script, bool warnings);
+        void add_script(std::istream& script, bool warnings);
+        // Set number of subpixel phases per axis for translation animation rasters (0 = no reuse)
+        void set_subpixel_phases(int phases);
+        // Set number of subpixel phases per axis for stamped dot sprites (0 = dots filled as path)
+        void set_dot_phases(int phases);
+        // Set fill rasterizer (internal scanline rasterizer or cairo)
+        void set_scanline_rasterizer(bool enable);
+        // Set frame rate of host to quantize render times to his frame grid (0 = no quantization)
+        void set_frame_grid(unsigned long int fps_num, unsigned long int fps_den);
         // Change frame meta informations
         void set_target(int width, int height, Colorspace format);
         // Render SSB contents on frame
         void render(unsigned char* frame, int pitch, unsigned long int start_ms) noexcept;
+        // Render SSB contents on frame region (frame data just covers the region)
+        void render_region(unsigned char* frame, int pitch, unsigned long int start_ms, int x, int y, int width, int height) noexcept;
+        // Render SSB contents on multiple frames of any size (layout + paths get shared, feedback refers to first frame)
+        void render_multi(const std::vector<Target>& targets, unsigned long int start_ms) noexcept;
+        // Get frame areas modified by last render
+        const std::vector<Rect>& get_dirty_rects() const;
+        // Get content signature of last render (+ difference to the render before)
+        unsigned long long int get_signature(bool* changed = nullptr) const;
+        // Get cache statistics (since creation, textures since program start)
+        Stats get_stats() const;
 };
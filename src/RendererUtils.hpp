@@ -60,20 +60,124 @@ namespace{
             words.push_back({"", ""});
         return words;
     }
-    // Creates new image with applied fade
-    CairoImage create_faded_image(CairoImage image, double fade_in, double fade_out,
-                                  unsigned long int cur_ms, unsigned long int start_ms, unsigned long int end_ms){
+    // Checks event for animations of given tag types only
+    inline bool has_animations_only(SSBEvent& event, std::initializer_list<SSBTag::Type> types){
+        bool animated = false;
+        for(std::shared_ptr<SSBObject>& obj : event.objects)
+            if(obj->type == SSBObject::Type::TAG){
+                SSBTag* tag = dynamic_cast<SSBTag*>(obj.get());
+                if(tag->type == SSBTag::Type::ANIMATE){
+                    for(std::shared_ptr<SSBObject>& animate_obj : dynamic_cast<SSBAnimate*>(tag)->objects){
+                        if(std::find(types.begin(), types.end(), dynamic_cast<SSBTag*>(animate_obj.get())->type) == types.end())
+                            return false;
+                    }
+                    animated = true;
+                }else if(tag->type == SSBTag::Type::KARAOKE)
+                    return false;
+            }
+        return animated;
+    }
+    // Collects texture filenames of script (unique, animated ones included)
+    inline std::vector<std::string> get_texture_filenames(SSBData& data){
+        std::vector<std::string> filenames;
+        auto add_filename = [&filenames](std::shared_ptr<SSBObject>& obj){
+            if(obj->type == SSBObject::Type::TAG && dynamic_cast<SSBTag*>(obj.get())->type == SSBTag::Type::TEXTURE){
+                std::string& filename = dynamic_cast<SSBTexture*>(obj.get())->filename;
+                if(!filename.empty() && std::find(filenames.begin(), filenames.end(), filename) == filenames.end())
+                    filenames.push_back(filename);
+            }
+        };
+        for(SSBEvent& event : data.events)
+            for(std::shared_ptr<SSBObject>& obj : event.objects){
+                add_filename(obj);
+                if(obj->type == SSBObject::Type::TAG && dynamic_cast<SSBTag*>(obj.get())->type == SSBTag::Type::ANIMATE)
+                    for(std::shared_ptr<SSBObject>& animate_obj : dynamic_cast<SSBAnimate*>(obj.get())->objects)
+                        add_filename(animate_obj);
+            }
+        return filenames;
+    }
+    // Checks event for karaoke without animations
+    inline bool has_karaoke_only(SSBEvent& event){
+        bool karaoke = false;
+        for(std::shared_ptr<SSBObject>& obj : event.objects)
+            if(obj->type == SSBObject::Type::TAG){
+                SSBTag* tag = dynamic_cast<SSBTag*>(obj.get());
+                if(tag->type == SSBTag::Type::ANIMATE)
+                    return false;
+                else if(tag->type == SSBTag::Type::KARAOKE)
+                    karaoke = true;
+            }
+        return karaoke;
+    }
+    // Gets time segment of event with constant animations & karaoke state (false if state changes at inner time)
+    inline bool get_time_segment(SSBEvent& event, SSBTime inner_ms, SSBTime inner_duration, long int& segment){
+        segment = 0;
+        long int karaoke_start = -1, karaoke_duration = 0;
+        for(std::shared_ptr<SSBObject>& obj : event.objects)
+            if(obj->type == SSBObject::Type::TAG){
+                SSBTag* tag = dynamic_cast<SSBTag*>(obj.get());
+                if(tag->type == SSBTag::Type::ANIMATE){
+                    // Calculate start & end time (see RenderState::eval_tag)
+                    SSBAnimate* animate = dynamic_cast<SSBAnimate*>(tag);
+                    SSBTime animate_start, animate_end;
+                    constexpr decltype(animate->start) max_duration = std::numeric_limits<decltype(animate->start)>::max();
+                    if(animate->start == max_duration && animate->end == max_duration){
+                        animate_start = 0;
+                        animate_end = inner_duration;
+                    }else{
+                        animate_start = animate->start >= 0 ? animate->start : inner_duration + animate->start;
+                        animate_end = animate->end > 0 ? animate->end : inner_duration + animate->end;
+                    }
+                    // Progress changes in animation window
+                    if(inner_ms > animate_start && inner_ms <= animate_end)
+                        return false;
+                    segment += (inner_ms > animate_start) + (inner_ms > animate_end);
+                }else if(tag->type == SSBTag::Type::KARAOKE){
+                    // Calculate karaoke time (see RenderState::eval_tag)
+                    SSBKaraoke* karaoke = dynamic_cast<SSBKaraoke*>(tag);
+                    switch(karaoke->type){
+                        case SSBKaraoke::Type::DURATION:
+                            if(karaoke_start < 0)
+                                karaoke_start = 0;
+                            karaoke_start += karaoke_duration;
+                            karaoke_duration = karaoke->time;
+                            break;
+                        case SSBKaraoke::Type::SET:
+                            karaoke_start = karaoke->time;
+                            karaoke_duration = 0;
+                            break;
+                    }
+                    // Karaoke changes in his duration
+                    const long int elapsed_time = inner_ms;
+                    if(elapsed_time >= karaoke_start && elapsed_time < karaoke_start + karaoke_duration)
+                        return false;
+                    segment += (elapsed_time >= karaoke_start) + (elapsed_time >= karaoke_start + karaoke_duration);
+                }
+            }
+        return true;
+    }
+    // Calculates fade alpha at given time (1 = no fade)
+    inline double get_fade_alpha(double fade_in, double fade_out,
+                                 unsigned long int cur_ms, unsigned long int start_ms, unsigned long int end_ms){
         if(cur_ms >= start_ms && cur_ms < end_ms &&
            fade_in >= 0 && fade_out >= 0){
             decltype(cur_ms) inner_ms = cur_ms - start_ms;
             decltype(cur_ms) inv_inner_ms = end_ms - start_ms - inner_ms;
-            double alpha;
             if(inner_ms < fade_in)
-                alpha = static_cast<double>(inner_ms) / fade_in;
+                return static_cast<double>(inner_ms) / fade_in;
             else if(inv_inner_ms < fade_out)
-                alpha = static_cast<double>(inv_inner_ms) / fade_out;
-            else
-                return image;
+                return static_cast<double>(inv_inner_ms) / fade_out;
+        }
+        return 1;
+    }
+    // Creates new image with applied fade
+    CairoImage create_faded_image(CairoImage image, double fade_in, double fade_out,
+                                  unsigned long int cur_ms, unsigned long int start_ms, unsigned long int end_ms){
+        double alpha = get_fade_alpha(fade_in, fade_out, cur_ms, start_ms, end_ms);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+        if(alpha != 1){
+#pragma GCC diagnostic pop
             CairoImage new_image(cairo_image_surface_get_width(image), cairo_image_surface_get_height(image), cairo_image_surface_get_format(image));
             cairo_set_operator(new_image, CAIRO_OPERATOR_SOURCE);
             cairo_set_source_rgba(new_image, 0, 0, 0, alpha);
@@ -85,6 +189,21 @@ namespace{
         }else
             return image;
     }
+    // Hashes data into 64-bit FNV-1a hash
+    inline void hash_data(unsigned long long int& hash, const void* data, size_t size){
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        for(const unsigned char* bytes_end = bytes + size; bytes != bytes_end; ++bytes)
+            hash = (hash ^ *bytes) * 1099511628211ULL;
+    }
+    template<typename T>
+    inline void hash_value(unsigned long long int& hash, const T& value){
+        hash_data(hash, &value, sizeof(T));
+    }
+    // Hashes path operations & points
+    inline void hash_path(unsigned long long int& hash, const CairoPath& path){
+        hash_data(hash, path.get_ops().data(), path.get_ops().size() * sizeof(cairo_path_data_type_t));
+        hash_data(hash, path.get_points().data(), path.get_points().size() * sizeof(double));
+    }
     // Applies deform filter on cairo path
     void path_deform(cairo_t* ctx, std::string& deform_x, std::string& deform_y, double progress){
         mu::Parser parser_x, parser_y;
@@ -312,8 +431,4 @@ namespace{
             cairo_set_dash(ctx, rs.dashes.data(), rs.dashes.size(), rs.dash_offset);
         }
     }
-    // Simple threading layer
-    static THREAD_FUNC_BEGIN(call_in_thread)
-        (*reinterpret_cast<std::function<void()>*>(userdata))();
-    THREAD_FUNC_END
 }
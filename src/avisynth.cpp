@@ -68,6 +68,7 @@ namespace AVS{
         AVSClip clip(env, avs_array_elt(args, 0));
         std::string script = avs_as_string(avs_array_elt(args, 1));
         bool warnings = avs_defined(avs_array_elt(args, 2)) ? avs_as_bool(avs_array_elt(args, 2)) : true;
+        bool frame_cache = avs_defined(avs_array_elt(args, 3)) ? avs_as_bool(avs_array_elt(args, 3)) : false;
         // Check filter arguments
         const AVS_VideoInfo* video_info = avs_lib->avs_get_video_info(clip);
         if(!avs_has_video(video_info))  // Clip must have a video stream
@@ -80,7 +81,10 @@ namespace AVS{
             AVS_FilterInfo* filter_info = clip.info();
             // Allocate renderer
             try{
-                filter_info->user_data = new Renderer(video_info->width, video_info->height, avs_is_rgb32(video_info) ? Renderer::Colorspace::BGRA : Renderer::Colorspace::BGR, script, warnings);
+                Renderer* renderer = new Renderer(video_info->width, video_info->height, avs_is_rgb32(video_info) ? Renderer::Colorspace::BGRA : Renderer::Colorspace::BGR, script, warnings);
+                if(frame_cache)
+                    renderer->set_frame_grid(video_info->fps_numerator, video_info->fps_denominator);
+                filter_info->user_data = renderer;
             }catch(std::string err){
                 return avs_new_value_error(err.c_str());
             }
@@ -106,7 +110,7 @@ AVSC_EXPORT const char* avisynth_c_plugin_init(AVS_ScriptEnvironment* env){
     // Valid Avisynth interface version?
     AVS::avs_lib->avs_check_version(env, AVISYNTH_INTERFACE_VERSION);
     // Register functin to Avisynth scripting environment
-    AVS::avs_lib->avs_add_function(env, FILTER_NAME, "cs[warnings]b", AVS::apply_filter, nullptr);
+    AVS::avs_lib->avs_add_function(env, FILTER_NAME, "cs[warnings]b[frame_cache]b", AVS::apply_filter, nullptr);
     // Return plugin description
     return FILTER_DESCRIPTION;
 }
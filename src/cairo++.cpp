@@ -17,37 +17,220 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "FileReader.hpp"
 #include <cmath>
 #include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <chrono>
 #include "sse.hpp"
+#include <emmintrin.h>
 #include "thread.h"
 #ifdef _WIN32
 #include "textconv.hpp"
 #endif
 
-Cache<std::string,CairoImage> CairoImage::cache;
+namespace{
+    // Mutex with lifetime
+    struct Mutex{
+        nmutex_t mutex;
+        Mutex(){nmutex_init(&this->mutex);}
+        ~Mutex(){nmutex_destroy(&this->mutex);}
+    };
+    // Lock of file image cache
+    Mutex file_cache_mutex;
+    // File images in decoding (by filename + search directory; locked by decoding thread till cached, other threads wait for it instead of decoding again)
+    struct FileDecode{
+        std::string filename, dir;
+        std::shared_ptr<Mutex> lock;
+    };
+    std::vector<FileDecode> file_decodes;
+}
+
+std::deque<CairoImage::FileImage> CairoImage::file_cache;
+size_t CairoImage::file_cache_bytes = 0, CairoImage::file_cache_budget = 256 << 20;
+CairoImage::FileStats CairoImage::file_stats = {0, 0, 0, 0};
+
+std::shared_ptr<std::vector<CairoImage>> CairoImage::get_file(std::string& png_filename, const std::string& dir, bool count){
+    nmutex_lock(&file_cache_mutex.mutex);
+    if(count)
+        ++file_stats.lookups;
+    while(true){
+        // Reuse file image
+        for(auto it = file_cache.begin(); it != file_cache.end(); ++it)
+            if(it->filename == png_filename && it->dir == dir){
+                FileImage file_image = *it;
+                file_cache.erase(it);
+                file_cache.push_front(file_image);
+                if(count)
+                    ++file_stats.hits;
+                nmutex_unlock(&file_cache_mutex.mutex);
+                return file_image.levels;
+            }
+        // Wait for decoding by another thread, then look again
+        auto decode = std::find_if(file_decodes.begin(), file_decodes.end(), [&png_filename,&dir](const FileDecode& decode){return decode.filename == png_filename && decode.dir == dir;});
+        if(decode == file_decodes.end())
+            break;
+        std::shared_ptr<Mutex> decode_lock = decode->lock;
+        nmutex_unlock(&file_cache_mutex.mutex);
+        nmutex_lock(&decode_lock->mutex);
+        nmutex_unlock(&decode_lock->mutex);
+        nmutex_lock(&file_cache_mutex.mutex);
+    }
+    // Register decoding
+    std::shared_ptr<Mutex> decode_lock = std::make_shared<Mutex>();
+    nmutex_lock(&decode_lock->mutex);
+    file_decodes.push_back({png_filename, dir, decode_lock});
+    nmutex_unlock(&file_cache_mutex.mutex);
+    // Decode file image (without cache lock, other files may get decoded in parallel)
+    std::shared_ptr<std::vector<CairoImage>> levels;
+    double decode_ms = 0;
+    FileReader file(png_filename, dir);
+    if(file){
+        const auto decode_start = std::chrono::steady_clock::now();
+        CairoImage image;
+        cairo_surface_destroy(image.surface);
+        image.surface = cairo_image_surface_create_from_png_stream([](void* closure, unsigned char* data, unsigned int length){
+                if(reinterpret_cast<FileReader*>(closure)->read(length, data) == length)
+                    return CAIRO_STATUS_SUCCESS;
+                else
+                    return CAIRO_STATUS_READ_ERROR;
+            }, &file);
+        if(cairo_surface_status(image.surface) == CAIRO_STATUS_SUCCESS){
+            // Convert to 32-bit format (for direct pixel access)
+            if(cairo_image_surface_get_format(image.surface) != CAIRO_FORMAT_ARGB32 && cairo_image_surface_get_format(image.surface) != CAIRO_FORMAT_RGB24){
+                CairoImage converted(cairo_image_surface_get_width(image.surface), cairo_image_surface_get_height(image.surface), CAIRO_FORMAT_ARGB32);
+                cairo_set_source_surface(converted, image.surface, 0, 0);
+                cairo_paint(converted);
+                image = converted;
+            }
+            levels = std::make_shared<std::vector<CairoImage>>(1, image);
+            decode_ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - decode_start).count();
+        }
+    }
+    // Add file image to cache + unregister decoding (failed ones aren't cached, waiting threads try themselves)
+    nmutex_lock(&file_cache_mutex.mutex);
+    if(levels){
+        ++file_stats.decodes,
+        file_stats.decode_ms += decode_ms;
+        const size_t bytes = cairo_image_surface_get_stride(levels->front()) * cairo_image_surface_get_height(levels->front());
+        file_cache.push_front({png_filename, dir, levels, bytes});
+        file_cache_bytes += bytes;
+        while(file_cache_bytes > file_cache_budget && file_cache.size() > 1)
+            file_cache_bytes -= file_cache.back().bytes,
+            file_cache.pop_back();
+    }
+    file_decodes.erase(std::find_if(file_decodes.begin(), file_decodes.end(), [&decode_lock](const FileDecode& decode){return decode.lock == decode_lock;}));
+    nmutex_unlock(&decode_lock->mutex);
+    nmutex_unlock(&file_cache_mutex.mutex);
+    return levels;
+}
+
+void CairoImage::set_file_cache_budget(size_t bytes){
+    nmutex_lock(&file_cache_mutex.mutex);
+    file_cache_budget = bytes;
+    while(file_cache_bytes > file_cache_budget && file_cache.size() > 1)
+        file_cache_bytes -= file_cache.back().bytes,
+        file_cache.pop_back();
+    nmutex_unlock(&file_cache_mutex.mutex);
+}
+
+CairoImage::FileStats CairoImage::get_file_stats(){
+    nmutex_lock(&file_cache_mutex.mutex);
+    const FileStats stats = file_stats;
+    nmutex_unlock(&file_cache_mutex.mutex);
+    return stats;
+}
 
 CairoImage::CairoImage() : surface(cairo_image_surface_create(CAIRO_FORMAT_A1, 1, 1)){}
 
 CairoImage::CairoImage(int width, int height, cairo_format_t format) : surface(cairo_image_surface_create(format, width, height)){}
 
-CairoImage::CairoImage(std::string png_filename) : context(nullptr){
-    // Reuse file image
-    if(this->cache.contains(png_filename))
-        this->surface = cairo_surface_reference(this->cache.get(png_filename));
-    // Create new file image
-    else{
-        FileReader file(png_filename);
-        if(file){
-            this->surface = cairo_image_surface_create_from_png_stream([](void* closure, unsigned char* data, unsigned int length){
-                    if(reinterpret_cast<FileReader*>(closure)->read(length, data) == length)
-                        return CAIRO_STATUS_SUCCESS;
-                    else
-                        return CAIRO_STATUS_READ_ERROR;
-                }, &file);
-            // Add valid file image to cache
-            if(cairo_surface_status(this->surface) == CAIRO_STATUS_SUCCESS)
-                this->cache.add(png_filename, *this);
-        }else
-            this->surface = cairo_image_surface_create(CAIRO_FORMAT_INVALID, 1, 1);
+CairoImage::CairoImage(std::string png_filename, const std::string& dir, unsigned int mip_level, cairo_matrix_t* level_matrix) : context(nullptr){
+    // Get file image levels
+    std::shared_ptr<std::vector<CairoImage>> levels = get_file(png_filename, dir, true);
+    if(!levels){
+        this->surface = cairo_image_surface_create(CAIRO_FORMAT_INVALID, 1, 1);
+        return;
+    }
+    // Get last existing level
+    nmutex_lock(&file_cache_mutex.mutex);
+    const size_t src_level = levels->size() - 1;
+    CairoImage src_image = levels->back();
+    nmutex_unlock(&file_cache_mutex.mutex);
+    // Create missing mip levels (2x2 pixels averaged, edges clamped; without cache lock, other images may get scaled in parallel)
+    std::vector<CairoImage> new_levels;
+    while(src_level + new_levels.size() < mip_level){
+        cairo_surface_t* src = new_levels.empty() ? src_image : new_levels.back();
+        const int src_width = cairo_image_surface_get_width(src), src_height = cairo_image_surface_get_height(src),
+            src_stride = cairo_image_surface_get_stride(src);
+        if(src_width <= 1 && src_height <= 1)
+            break;
+        CairoImage level((src_width + 1) >> 1, (src_height + 1) >> 1, cairo_image_surface_get_format(src));
+        cairo_surface_t* dst = level;
+        const int dst_width = cairo_image_surface_get_width(dst), dst_height = cairo_image_surface_get_height(dst),
+            dst_stride = cairo_image_surface_get_stride(dst);
+        cairo_surface_flush(src);
+        const unsigned char* src_data = cairo_image_surface_get_data(src);
+        unsigned char* dst_data = cairo_image_surface_get_data(dst);
+        for(int y = 0; y < dst_height; ++y){
+            const uint32_t* src_row1 = reinterpret_cast<const uint32_t*>(src_data + (y << 1) * src_stride),
+                *src_row2 = reinterpret_cast<const uint32_t*>(src_data + std::min((y << 1) + 1, src_height - 1) * src_stride);
+            uint32_t* dst_row = reinterpret_cast<uint32_t*>(dst_data + y * dst_stride);
+            for(int x = 0; x < dst_width; ++x){
+                const int x1 = x << 1, x2 = std::min(x1 + 1, src_width - 1);
+                dst_row[x] = _mm_cvtsi128_si32(_mm_avg_epu8(
+                    _mm_avg_epu8(_mm_cvtsi32_si128(src_row1[x1]), _mm_cvtsi32_si128(src_row1[x2])),
+                    _mm_avg_epu8(_mm_cvtsi32_si128(src_row2[x1]), _mm_cvtsi32_si128(src_row2[x2]))
+                ));
+            }
+        }
+        cairo_surface_mark_dirty(dst);
+        new_levels.push_back(level);
+    }
+    // Add levels not added by another thread meanwhile
+    nmutex_lock(&file_cache_mutex.mutex);
+    for(size_t i = levels->size() - (src_level + 1); i < new_levels.size(); ++i){
+        levels->push_back(new_levels[i]);
+        // Count level to cache size (if file image is still cached)
+        for(FileImage& file_image : file_cache)
+            if(file_image.levels == levels){
+                const size_t bytes = cairo_image_surface_get_stride(new_levels[i]) * cairo_image_surface_get_height(new_levels[i]);
+                file_image.bytes += bytes,
+                file_cache_bytes += bytes;
+                break;
+            }
+    }
+    // Reference image of mip level
+    this->surface = cairo_surface_reference((*levels)[std::min(static_cast<size_t>(mip_level), levels->size() - 1)]);
+    if(level_matrix)
+        cairo_matrix_init_scale(level_matrix,
+                                static_cast<double>(cairo_image_surface_get_width(this->surface)) / cairo_image_surface_get_width(levels->front()),
+                                static_cast<double>(cairo_image_surface_get_height(this->surface)) / cairo_image_surface_get_height(levels->front()));
+    // Keep cache in budget
+    while(file_cache_bytes > file_cache_budget && file_cache.size() > 1)
+        file_cache_bytes -= file_cache.back().bytes,
+        file_cache.pop_back();
+    nmutex_unlock(&file_cache_mutex.mutex);
+}
+
+CairoImagePreload::CairoImagePreload(std::vector<std::string> png_filenames, const std::string& dir) : filenames(png_filenames), dir(dir), next(0){
+    if(this->filenames.empty())
+        return;
+    // Decode next files till none left
+    this->work = [this](){
+        for(size_t i; (i = this->next++) < this->filenames.size();)
+            CairoImage::get_file(this->filenames[i], this->dir, false);
+    };
+    // Start workers (as many as processors, but not more than files)
+    const size_t threads_n = std::min(static_cast<size_t>(std::max(nthread_get_processors_num(), 1u)), this->filenames.size());
+    for(size_t i = 0; i < threads_n; ++i)
+        this->threads.push_back(nthread_create(call_in_thread, &this->work));
+}
+
+CairoImagePreload::~CairoImagePreload(){
+    // Skip remaining files + wait for decodings in progress
+    this->next = this->filenames.size();
+    for(nthread_t thread : this->threads){
+        nthread_join(thread);
+        nthread_destroy(thread);
     }
 }
 
@@ -84,6 +267,118 @@ CairoImage::operator cairo_t*(){
     return this->context;
 }
 
+CairoPath::CairoPath() : ops(std::make_shared<std::vector<cairo_path_data_type_t>>()){}
+
+CairoPath::CairoPath(const cairo_path_t* path) : ops(std::make_shared<std::vector<cairo_path_data_type_t>>()){
+    for(int i = 0; i < path->num_data; i += path->data[i].header.length){
+        const cairo_path_data_t* data = &path->data[i];
+        this->ops->push_back(data->header.type);
+        for(int j = 1; j < data->header.length; ++j)
+            this->points.push_back(data[j].point.x),
+            this->points.push_back(data[j].point.y);
+    }
+}
+
+CairoPath CairoPath::transformed(const cairo_matrix_t& matrix) const{
+    CairoPath path;
+    path.ops = this->ops;
+    path.points.resize(this->points.size());
+    // Multiply points with matrix columns + add translation (SSE2: x & y at once)
+    const __m128d col_x = _mm_set_pd(matrix.yx, matrix.xx),
+        col_y = _mm_set_pd(matrix.yy, matrix.xy),
+        translation = _mm_set_pd(matrix.y0, matrix.x0);
+    for(size_t i = 0; i < this->points.size(); i += 2){
+        const __m128d point = _mm_loadu_pd(&this->points[i]);
+        _mm_storeu_pd(&path.points[i], _mm_add_pd(_mm_add_pd(_mm_mul_pd(col_x, _mm_unpacklo_pd(point, point)), _mm_mul_pd(col_y, _mm_unpackhi_pd(point, point))), translation));
+    }
+    return path;
+}
+
+bool CairoPath::closed() const{
+    bool segments = false, closed = false;
+    for(cairo_path_data_type_t op : *this->ops)
+        switch(op){
+            case CAIRO_PATH_MOVE_TO:
+                if(segments && !closed)
+                    return false;
+                segments = closed = false;
+                break;
+            case CAIRO_PATH_LINE_TO:
+            case CAIRO_PATH_CURVE_TO:
+                segments = true,
+                closed = false;
+                break;
+            case CAIRO_PATH_CLOSE_PATH:
+                closed = true;
+                break;
+        }
+    return !segments || closed;
+}
+
+void CairoPath::extents(double& x1, double& y1, double& x2, double& y2) const{
+    // Collect minimum & maximum of drawn points (SSE2: x & y at once)
+    __m128d min = _mm_set1_pd(std::numeric_limits<double>::infinity()),
+        max = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    const double* point = this->points.data(), *move = nullptr;
+    for(cairo_path_data_type_t op : *this->ops)
+        switch(op){
+            case CAIRO_PATH_MOVE_TO:
+                move = point;
+                point += 2;
+                break;
+            case CAIRO_PATH_LINE_TO:
+            case CAIRO_PATH_CURVE_TO:
+                if(move){
+                    min = _mm_min_pd(min, _mm_loadu_pd(move)),
+                    max = _mm_max_pd(max, _mm_loadu_pd(move));
+                    move = nullptr;
+                }
+                for(const double* point_end = point + (op == CAIRO_PATH_LINE_TO ? 2 : 6); point != point_end; point += 2)
+                    min = _mm_min_pd(min, _mm_loadu_pd(point)),
+                    max = _mm_max_pd(max, _mm_loadu_pd(point));
+                break;
+            case CAIRO_PATH_CLOSE_PATH:
+                break;
+        }
+    double min_values[2], max_values[2];
+    _mm_storeu_pd(min_values, min);
+    _mm_storeu_pd(max_values, max);
+    if(min_values[0] > max_values[0])
+        x1 = y1 = x2 = y2 = 0;
+    else
+        x1 = min_values[0], y1 = min_values[1], x2 = max_values[0], y2 = max_values[1];
+}
+
+void CairoPath::to_cairo(cairo_t* ctx) const{
+    const double* point = this->points.data();
+    for(cairo_path_data_type_t op : *this->ops)
+        switch(op){
+            case CAIRO_PATH_MOVE_TO:
+                cairo_move_to(ctx, point[0], point[1]);
+                point += 2;
+                break;
+            case CAIRO_PATH_LINE_TO:
+                cairo_line_to(ctx, point[0], point[1]);
+                point += 2;
+                break;
+            case CAIRO_PATH_CURVE_TO:
+                cairo_curve_to(ctx, point[0], point[1], point[2], point[3], point[4], point[5]);
+                point += 6;
+                break;
+            case CAIRO_PATH_CLOSE_PATH:
+                cairo_close_path(ctx);
+                break;
+        }
+}
+
+const std::vector<cairo_path_data_type_t>& CairoPath::get_ops() const{
+    return *this->ops;
+}
+
+const std::vector<double>& CairoPath::get_points() const{
+    return this->points;
+}
+
 #ifdef _WIN32
 NativeFont::NativeFont(std::wstring family, bool bold, bool italic, bool underline, bool strikeout, float size, bool rtl){
     this->dc = CreateCompatibleDC(NULL);
@@ -340,6 +635,133 @@ cairo_pattern_t* cairo_pattern_create_rect_color(cairo_rectangle_t rect,
     return mesh;
 }
 
+void cairo_image_surface_rect_color(cairo_surface_t* surface, const cairo_matrix_t* matrix, cairo_rectangle_t rect,
+                                    double r0, double g0, double b0, double a0,
+                                    double r1, double g1, double b1, double a1,
+                                    double r2, double g2, double b2, double a2,
+                                    double r3, double g3, double b3, double a3){
+    // Check surface type & size
+    if(cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE || cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32)
+        return;
+    const int width = cairo_image_surface_get_width(surface), height = cairo_image_surface_get_height(surface),
+        stride = cairo_image_surface_get_stride(surface);
+    if(width <= 0 || height <= 0)
+        return;
+    // Get image-to-rectangle matrix (rectangle normalized to 0-1)
+    cairo_matrix_t inverse = *matrix;
+    if(cairo_matrix_invert(&inverse) != CAIRO_STATUS_SUCCESS)
+        return;
+    const double scale_x = rect.width > 0 ? 1 / rect.width : 0, scale_y = rect.height > 0 ? 1 / rect.height : 0;
+    // Corner colors as premultiplied BGRA (top-left, top-right, bottom-right, bottom-left) to bilinear terms: c0 + c1 * u + c2 * v + c3 * u * v
+    const __m128 corner0 = _mm_setr_ps(b0 * a0, g0 * a0, r0 * a0, a0), corner1 = _mm_setr_ps(b1 * a1, g1 * a1, r1 * a1, a1),
+        corner2 = _mm_setr_ps(b2 * a2, g2 * a2, r2 * a2, a2), corner3 = _mm_setr_ps(b3 * a3, g3 * a3, r3 * a3, a3),
+        term0 = corner0,
+        term1 = _mm_sub_ps(corner1, corner0),
+        term2 = _mm_sub_ps(corner3, corner0),
+        term3 = _mm_sub_ps(_mm_add_ps(corner0, corner2), _mm_add_ps(corner1, corner3));
+    // Top colors equal bottom colors -> linear gradient (just horizontal interpolation)
+    const bool linear = _mm_movemask_ps(_mm_and_ps(_mm_cmpeq_ps(term2, _mm_setzero_ps()), _mm_cmpeq_ps(term3, _mm_setzero_ps()))) == 0xf;
+    // Replace covered pixels (alpha = coverage) by gradient color
+    cairo_surface_flush(surface);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    const __m128i zero = _mm_setzero_si128();
+    const double du = inverse.xx * scale_x, dv = inverse.yx * scale_y;
+    for(int y = 0; y < height; ++y){
+        uint32_t* row = reinterpret_cast<uint32_t*>(data + y * stride);
+        // Rectangle position of first pixel center in row
+        double u = (inverse.xx * 0.5 + inverse.xy * (y + 0.5) + inverse.x0 - rect.x) * scale_x,
+            v = (inverse.yx * 0.5 + inverse.yy * (y + 0.5) + inverse.y0 - rect.y) * scale_y;
+        for(int x = 0; x < width; ++x, u += du, v += dv){
+            const uint32_t coverage = row[x] >> 24;
+            if(coverage == 0)
+                continue;
+            // Interpolate color (clamped to rectangle)
+            const __m128 pu = _mm_set1_ps(std::max(0.0, std::min(u, 1.0)));
+            __m128 color = _mm_add_ps(term0, _mm_mul_ps(term1, pu));
+            if(!linear){
+                const __m128 pv = _mm_set1_ps(std::max(0.0, std::min(v, 1.0)));
+                color = _mm_add_ps(color, _mm_mul_ps(_mm_add_ps(term2, _mm_mul_ps(term3, pu)), pv));
+            }
+            // Scale by coverage (0-255) & pack to BGRA
+            const __m128i color_i = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_set1_ps(coverage)));
+            row[x] = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(color_i, zero), zero));
+        }
+    }
+    cairo_surface_mark_dirty(surface);
+}
+
+namespace{
+    // Texel index by extend mode (-1 = outside)
+    inline int texel_index(int i, int size, cairo_extend_t extend){
+        switch(extend){
+            case CAIRO_EXTEND_NONE: return i >= 0 && i < size ? i : -1;
+            case CAIRO_EXTEND_PAD: return std::max(0, std::min(i, size - 1));
+            case CAIRO_EXTEND_REPEAT: return (i %= size) < 0 ? i + size : i;
+            case CAIRO_EXTEND_REFLECT:
+                if((i %= size << 1) < 0)
+                    i += size << 1;
+                return i < size ? i : (size << 1) - 1 - i;
+        }
+        return -1;
+    }
+}
+
+void cairo_image_surface_modulate(cairo_surface_t* surface, cairo_surface_t* texture, const cairo_matrix_t* matrix, cairo_extend_t extend){
+    // Check surfaces type & size
+    if(cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE || cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32 ||
+       cairo_surface_get_type(texture) != CAIRO_SURFACE_TYPE_IMAGE ||
+       (cairo_image_surface_get_format(texture) != CAIRO_FORMAT_ARGB32 && cairo_image_surface_get_format(texture) != CAIRO_FORMAT_RGB24))
+        return;
+    const int width = cairo_image_surface_get_width(surface), height = cairo_image_surface_get_height(surface),
+        stride = cairo_image_surface_get_stride(surface),
+        tex_width = cairo_image_surface_get_width(texture), tex_height = cairo_image_surface_get_height(texture),
+        tex_stride = cairo_image_surface_get_stride(texture);
+    if(width <= 0 || height <= 0 || tex_width <= 0 || tex_height <= 0)
+        return;
+    // Texture without alpha channel gets opaque
+    const uint32_t tex_alpha = cairo_image_surface_get_format(texture) == CAIRO_FORMAT_RGB24 ? 0xff000000 : 0;
+    // Multiply covered pixels (non-zero alpha) by bilinear sampled texture (premultiplied colors multiply like their alpha)
+    cairo_surface_flush(surface);
+    cairo_surface_flush(texture);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    const unsigned char* tex_data = cairo_image_surface_get_data(texture);
+    auto fetch = [&](int x, int y) -> __m128{
+        x = texel_index(x, tex_width, extend),
+        y = texel_index(y, tex_height, extend);
+        if(x < 0 || y < 0)
+            return _mm_setzero_ps();
+        const __m128i zero = _mm_setzero_si128();
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(
+            reinterpret_cast<const uint32_t*>(tex_data + y * tex_stride)[x] | tex_alpha
+        ), zero), zero));
+    };
+    const __m128 scale = _mm_set1_ps(1.0f / 65025);
+    const __m128i zero = _mm_setzero_si128();
+    for(int y = 0; y < height; ++y){
+        uint32_t* row = reinterpret_cast<uint32_t*>(data + y * stride);
+        // Texture position of first pixel center in row (relative to texel centers)
+        double tex_x = matrix->xx * 0.5 + matrix->xy * (y + 0.5) + matrix->x0 - 0.5,
+            tex_y = matrix->yx * 0.5 + matrix->yy * (y + 0.5) + matrix->y0 - 0.5;
+        for(int x = 0; x < width; ++x, tex_x += matrix->xx, tex_y += matrix->yx){
+            if(row[x] == 0)
+                continue;
+            // Sample texture
+            const double tex_x_floor = std::floor(tex_x), tex_y_floor = std::floor(tex_y);
+            const int texel_x = tex_x_floor, texel_y = tex_y_floor;
+            const __m128 weight_x = _mm_set1_ps(tex_x - tex_x_floor), weight_y = _mm_set1_ps(tex_y - tex_y_floor),
+                top = fetch(texel_x, texel_y), bottom = fetch(texel_x, texel_y + 1),
+                top_row = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(fetch(texel_x + 1, texel_y), top), weight_x)),
+                bottom_row = _mm_add_ps(bottom, _mm_mul_ps(_mm_sub_ps(fetch(texel_x + 1, texel_y + 1), bottom), weight_x)),
+                texel = _mm_add_ps(top_row, _mm_mul_ps(_mm_sub_ps(bottom_row, top_row), weight_y));
+            // Modulate pixel
+            const __m128 pixel = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(row[x]), zero), zero));
+            const __m128i result = _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(pixel, texel), scale));
+            row[x] = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(result, zero), zero));
+        }
+    }
+    cairo_surface_mark_dirty(surface);
+}
+
 namespace{
     struct blur_h_thread_data{
         // Kernel data
@@ -532,6 +954,240 @@ void cairo_image_surface_blur(cairo_surface_t* surface, float blur_h, float blur
     }
 }
 
+void cairo_fill_scanline_preserve(cairo_t* ctx){
+    // Get target size
+    cairo_surface_t* surface = cairo_get_target(ctx);
+    int width = cairo_image_surface_get_width(surface);
+    int height = cairo_image_surface_get_height(surface);
+    if(width <= 0 || height <= 0)
+        return;
+    // Get flattened path in device space
+    cairo_matrix_t matrix;
+    cairo_get_matrix(ctx, &matrix);
+    cairo_identity_matrix(ctx);
+    cairo_path_t* path = cairo_copy_path_flat(ctx);
+    cairo_set_matrix(ctx, &matrix);
+    // Get path box in image (outside gets no coverage; area left of image counts for first column)
+    double path_x1 = std::numeric_limits<double>::infinity(), path_y1 = path_x1, path_x2 = -path_x1, path_y2 = path_x2;
+    for(int i = 0; i < path->num_data; i += path->data[i].header.length)
+        if(path->data[i].header.type == CAIRO_PATH_MOVE_TO || path->data[i].header.type == CAIRO_PATH_LINE_TO)
+            path_x1 = std::min(path_x1, path->data[i+1].point.x),
+            path_y1 = std::min(path_y1, path->data[i+1].point.y),
+            path_x2 = std::max(path_x2, path->data[i+1].point.x),
+            path_y2 = std::max(path_y2, path->data[i+1].point.y);
+    const int box_x = floor(std::min(std::max(path_x1, 0.0), static_cast<double>(width))),
+        box_y = floor(std::min(std::max(path_y1, 0.0), static_cast<double>(height))),
+        box_width = static_cast<int>(ceil(std::min(std::max(path_x2, 0.0), static_cast<double>(width)))) - box_x,
+        box_height = static_cast<int>(ceil(std::min(std::max(path_y2, 0.0), static_cast<double>(height)))) - box_y;
+    if(box_width <= 0 || box_height <= 0){
+        cairo_path_destroy(path);
+        return;
+    }
+    // Accumulate signed areas of lines in cells of box (right of box width: overflow cells) + range of touched cells per row
+    int cells_stride = box_width + 2;
+    std::vector<float> cells(cells_stride * box_height, 0.0f);
+    std::vector<int> rows_begin(box_height, cells_stride), rows_end(box_height, 0);
+    auto draw_line = [&](double x0, double y0, double x1, double y1){
+        // Horizontal lines have no area
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+        if(y0 == y1)
+            return;
+#pragma GCC diagnostic pop
+        // Box coordinates
+        x0 -= box_x, x1 -= box_x,
+        y0 -= box_y, y1 -= box_y;
+        // Direction by winding
+        float dir = 1.0f;
+        if(y0 > y1)
+            std::swap(x0, x1), std::swap(y0, y1), dir = -1.0f;
+        double dxdy = (x1 - x0) / (y1 - y0),
+            x = y0 < 0 ? x0 - y0 * dxdy : x0;
+        for(int y = std::max(static_cast<int>(y0), 0), y_end = std::min(static_cast<int>(ceil(y1)), box_height); y < y_end; ++y){
+            float* row = cells.data() + y * cells_stride;
+            double dy = std::min(y + 1.0, y1) - std::max(static_cast<double>(y), y0),
+                x_next = x + dxdy * dy;
+            // Limit to box columns
+            double line_x0 = std::max(std::min(std::min(x, x_next), static_cast<double>(box_width)), 0.0),
+                line_x1 = std::max(std::min(std::max(x, x_next), static_cast<double>(box_width)), 0.0);
+            float d = dy * dir;
+            int x0_floor = floor(line_x0),
+                x1_ceil = ceil(line_x1);
+            if(x1_ceil <= x0_floor + 1){
+                // Line in one cell
+                float x_mid = 0.5 * (line_x0 + line_x1) - x0_floor;
+                row[x0_floor] += d - d * x_mid;
+                row[x0_floor + 1] += d * x_mid;
+                x1_ceil = x0_floor + 1;
+            }else{
+                // Line over multiple cells
+                float s = 1.0 / (line_x1 - line_x0),
+                    x0_frac = line_x0 - x0_floor,
+                    a0 = 0.5f * s * (1.0f - x0_frac) * (1.0f - x0_frac),
+                    x1_frac = line_x1 - x1_ceil + 1.0,
+                    a_end = 0.5f * s * x1_frac * x1_frac;
+                row[x0_floor] += d * a0;
+                if(x1_ceil == x0_floor + 2)
+                    row[x0_floor + 1] += d * (1.0f - a0 - a_end);
+                else{
+                    float a1 = s * (1.5f - x0_frac);
+                    row[x0_floor + 1] += d * (a1 - a0);
+                    for(int cell_x = x0_floor + 2; cell_x < x1_ceil - 1; ++cell_x)
+                        row[cell_x] += d * s;
+                    float a2 = a1 + (x1_ceil - x0_floor - 3) * s;
+                    row[x1_ceil - 1] += d * (1.0f - a2 - a_end);
+                }
+                row[x1_ceil] += d * a_end;
+            }
+            rows_begin[y] = std::min(rows_begin[y], x0_floor),
+            rows_end[y] = std::max(rows_end[y], x1_ceil + 1);
+            x = x_next;
+        }
+    };
+    // Draw lines of (closed) subpaths
+    double start_x = 0, start_y = 0, last_x = 0, last_y = 0;
+    for(int i = 0; i < path->num_data; i += path->data[i].header.length){
+        const cairo_path_data_t* data = &path->data[i];
+        switch(data->header.type){
+            case CAIRO_PATH_MOVE_TO:
+                draw_line(last_x, last_y, start_x, start_y);
+                start_x = last_x = data[1].point.x,
+                start_y = last_y = data[1].point.y;
+                break;
+            case CAIRO_PATH_LINE_TO:
+                draw_line(last_x, last_y, data[1].point.x, data[1].point.y);
+                last_x = data[1].point.x,
+                last_y = data[1].point.y;
+                break;
+            case CAIRO_PATH_CURVE_TO:   // Not in flattened path
+                break;
+            case CAIRO_PATH_CLOSE_PATH:
+                draw_line(last_x, last_y, start_x, start_y);
+                last_x = start_x,
+                last_y = start_y;
+                break;
+        }
+    }
+    draw_line(last_x, last_y, start_x, start_y);
+    cairo_path_destroy(path);
+    // Sum cells to coverage (nonzero winding) in spans: empty till first touched cell, summed over touched cells, constant after last one
+    CairoImage mask(box_width, box_height, CAIRO_FORMAT_A8);
+    int mask_stride = cairo_image_surface_get_stride(mask);
+    cairo_surface_flush(mask);
+    unsigned char* mask_data = cairo_image_surface_get_data(mask);
+    bool antialias = cairo_get_antialias(ctx) != CAIRO_ANTIALIAS_NONE;
+    for(int y = 0; y < box_height; ++y){
+        const float* row = cells.data() + y * cells_stride;
+        unsigned char* mask_row = mask_data + y * mask_stride;
+        float sum = 0;
+        unsigned char value = 0;
+        int x = rows_begin[y];
+        for(const int x_end = std::min(rows_end[y], box_width); x < x_end; ++x){
+            sum += row[x];
+            float coverage = std::min(std::abs(sum), 1.0f);
+            mask_row[x] = value = antialias ? coverage * 255 + 0.5f : (coverage >= 0.5f ? 255 : 0);
+        }
+        if(value && x < box_width)
+            std::fill(mask_row + x, mask_row + box_width, value);
+    }
+    cairo_surface_mark_dirty(mask);
+    // Paint source through coverage (path stays)
+    cairo_save(ctx);
+    cairo_identity_matrix(ctx);
+    cairo_mask_surface(ctx, mask, box_x, box_y);
+    cairo_restore(ctx);
+}
+
+namespace{
+    // Squared euclidean distance transform in one dimension (lower envelope of parabolas, Felzenszwalb & Huttenlocher)
+    void distance_transform(const float* f, float* d, int n, int* v, float* z){
+        int k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<float>::infinity();
+        z[1] = std::numeric_limits<float>::infinity();
+        for(int q = 1; q < n; ++q){
+            float s;
+            while((s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k])) <= z[k])
+                --k;
+            v[++k] = q;
+            z[k] = s;
+            z[k+1] = std::numeric_limits<float>::infinity();
+        }
+        k = 0;
+        for(int q = 0; q < n; ++q){
+            while(z[k+1] < q)
+                ++k;
+            d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+        }
+    }
+}
+void cairo_stroke_distance_preserve(cairo_t* ctx){
+    // Get target size
+    cairo_surface_t* surface = cairo_get_target(ctx);
+    if(cairo_image_surface_get_width(surface) <= 0 || cairo_image_surface_get_height(surface) <= 0)
+        return;
+    // Fill path in device space to coverage (with margin of radius around target, so fillings outside still grow borders inside)
+    cairo_matrix_t matrix;
+    cairo_get_matrix(ctx, &matrix);
+    cairo_identity_matrix(ctx);
+    cairo_path_t* path = cairo_copy_path(ctx);
+    double radius = cairo_get_line_width(ctx) / 2;
+    cairo_set_matrix(ctx, &matrix);
+    const int margin = std::ceil(radius) + 1,
+        width = cairo_image_surface_get_width(surface) + (margin << 1),
+        height = cairo_image_surface_get_height(surface) + (margin << 1);
+    CairoImage mask(width, height, CAIRO_FORMAT_A8);
+    cairo_translate(mask, margin, margin);
+    cairo_append_path(mask, path);
+    cairo_path_destroy(path);
+    cairo_set_antialias(mask, cairo_get_antialias(ctx));
+    cairo_set_fill_rule(mask, cairo_get_fill_rule(ctx));
+    cairo_fill(mask);
+    int mask_stride = cairo_image_surface_get_stride(mask);
+    cairo_surface_flush(mask);
+    unsigned char* mask_data = cairo_image_surface_get_data(mask);
+    // Nothing filled (zero area path) -> nothing to dilate, stroke instead
+    bool filled = false;
+    for(int y = 0; y < height && !filled; ++y)
+        filled = std::any_of(mask_data + y * mask_stride, mask_data + y * mask_stride + width, [](unsigned char coverage){return coverage >= 128;});
+    if(!filled){
+        cairo_stroke_preserve(ctx);
+        return;
+    }
+    // Squared distances of pixels to nearest filled pixel (separated in columns & rows)
+    const float infinity = static_cast<float>(width) * width + static_cast<float>(height) * height;
+    std::vector<float> distances(width * height), f(std::max(width, height)), d(f.size()), z(f.size() + 1);
+    std::vector<int> v(f.size());
+    for(int x = 0; x < width; ++x){
+        for(int y = 0; y < height; ++y)
+            f[y] = mask_data[y * mask_stride + x] >= 128 ? 0 : infinity;
+        distance_transform(f.data(), d.data(), height, v.data(), z.data());
+        for(int y = 0; y < height; ++y)
+            distances[y * width + x] = d[y];
+    }
+    for(int y = 0; y < height; ++y){
+        float* row = distances.data() + y * width;
+        std::copy(row, row + width, f.begin());
+        distance_transform(f.data(), row, width, v.data(), z.data());
+    }
+    // Coverage of dilation by radius (filled pixel centers lie half a pixel inside the outline)
+    bool antialias = cairo_get_antialias(ctx) != CAIRO_ANTIALIAS_NONE;
+    for(int y = 0; y < height; ++y){
+        const float* row = distances.data() + y * width;
+        unsigned char* mask_row = mask_data + y * mask_stride;
+        for(int x = 0; x < width; ++x){
+            float coverage = std::max(std::min(static_cast<float>(radius + 1 - std::sqrt(row[x])), 1.0f), 0.0f);
+            mask_row[x] = std::max(mask_row[x], static_cast<unsigned char>(antialias ? coverage * 255 + 0.5f : (coverage >= 0.5f ? 255 : 0)));
+        }
+    }
+    cairo_surface_mark_dirty(mask);
+    // Paint source through coverage (path stays)
+    cairo_save(ctx);
+    cairo_identity_matrix(ctx);
+    cairo_mask_surface(ctx, mask, -margin, -margin);
+    cairo_restore(ctx);
+}
+
 void cairo_apply_matrix(cairo_t* ctx, cairo_matrix_t* mat){
     cairo_path_t* path = cairo_copy_path(ctx);
     cairo_new_path(ctx);
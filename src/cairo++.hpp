@@ -22,20 +22,42 @@ Permission is granted to anyone to use this software for any purpose, including
 #include <pango/pangocairo.h>
 #endif
 #include "Cache.hpp"
+#include "thread.h"
 #include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <functional>
 
 class CairoImage{
     private:
         // Image + image context
         cairo_surface_t* surface;
         cairo_t* context = nullptr;
-        // File image cache
-        static Cache<std::string,CairoImage> cache;
+    public:
+        // File image cache statistics (since program start)
+        struct FileStats{
+            unsigned long int lookups, hits, decodes;
+            double decode_ms;
+        };
+    private:
+        // File image cache (by filename + search directory; decoded images + mip levels, created on demand, each of half size; limited in bytes, shared by threads)
+        struct FileImage{
+            std::string filename, dir;
+            std::shared_ptr<std::vector<CairoImage>> levels;
+            size_t bytes;
+        };
+        static std::deque<FileImage> file_cache;    // Most recently used first
+        static size_t file_cache_bytes, file_cache_budget;
+        static FileStats file_stats;
+        // Get levels of file image (from cache or new decoded with additional search directory; null on failure)
+        static std::shared_ptr<std::vector<CairoImage>> get_file(std::string& png_filename, const std::string& dir, bool count);
+        friend class CairoImagePreload;
     public:
         // Ctor & dtor
         CairoImage();
         CairoImage(int width, int height, cairo_format_t format);
-        CairoImage(std::string png_filename);
+        CairoImage(std::string png_filename, const std::string& dir, unsigned int mip_level = 0, cairo_matrix_t* level_matrix = nullptr);  // Additional search directory, mip level limited to 1x1 size, output scale from file image to level
         ~CairoImage();
         // Copy
         CairoImage(const CairoImage& image);
@@ -43,6 +65,48 @@ class CairoImage{
         // Cast
         operator cairo_surface_t*() const;
         operator cairo_t*();
+        // File image cache limit (bytes of images + mip levels; most recently used image is always kept)
+        static void set_file_cache_budget(size_t bytes);
+        static FileStats get_file_stats();
+};
+
+class CairoImagePreload{
+    private:
+        // Files to decode (next one by index) + additional search directory + worker threads
+        std::vector<std::string> filenames;
+        std::string dir;
+        std::atomic<size_t> next;
+        std::function<void()> work;
+        std::vector<nthread_t> threads;
+    public:
+        // Decode file images into cache in background (workers stop + get joined on destruction)
+        CairoImagePreload(std::vector<std::string> png_filenames, const std::string& dir);
+        ~CairoImagePreload();
+        // No copy
+        CairoImagePreload(const CairoImagePreload&) = delete;
+        CairoImagePreload& operator=(const CairoImagePreload&) = delete;
+};
+
+class CairoPath{
+    private:
+        // Operations (shared by transformed copies) + points (x & y coordinates)
+        std::shared_ptr<std::vector<cairo_path_data_type_t>> ops;
+        std::vector<double> points;
+    public:
+        // Ctor
+        CairoPath();
+        CairoPath(const cairo_path_t* path);
+        // Get path with transformed points
+        CairoPath transformed(const cairo_matrix_t& matrix) const;
+        // Get extents of points on path (lonely moves excluded)
+        void extents(double& x1, double& y1, double& x2, double& y2) const;
+        // All subpaths closed (lonely moves excluded)?
+        bool closed() const;
+        // Add path to context
+        void to_cairo(cairo_t* ctx) const;
+        // Data access
+        const std::vector<cairo_path_data_type_t>& get_ops() const;
+        const std::vector<double>& get_points() const;
 };
 
 class NativeFont{
@@ -99,8 +163,20 @@ cairo_pattern_t* cairo_pattern_create_rect_color(cairo_rectangle_t rect,
                                                         double r2, double g2, double b2, double a2,
                                                         double r3, double g3, double b3, double a3);
 
+void cairo_image_surface_rect_color(cairo_surface_t* surface, const cairo_matrix_t* matrix, cairo_rectangle_t rect,
+                                    double r0, double g0, double b0, double a0,
+                                    double r1, double g1, double b1, double a1,
+                                    double r2, double g2, double b2, double a2,
+                                    double r3, double g3, double b3, double a3);
+
+void cairo_image_surface_modulate(cairo_surface_t* surface, cairo_surface_t* texture, const cairo_matrix_t* matrix, cairo_extend_t extend);
+
 void cairo_image_surface_blur(cairo_surface_t* surface, float blur_h, float blur_v);
 
+void cairo_fill_scanline_preserve(cairo_t* ctx);
+
+void cairo_stroke_distance_preserve(cairo_t* ctx);
+
 void cairo_apply_matrix(cairo_t* ctx, cairo_matrix_t* mat);
 
 void cairo_copy_matrix(cairo_t* src, cairo_t* dst);
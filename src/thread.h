@@ -15,6 +15,8 @@ Permission is granted to anyone to use this software for any purpose, including
 
 #pragma once
 
+#include <functional>
+
 #ifdef _WIN32
 #include <windows.h>
 
@@ -37,6 +39,21 @@ inline unsigned nthread_get_processors_num(){
     return si.dwNumberOfProcessors;
 }
 
+typedef CRITICAL_SECTION nmutex_t;
+
+inline void nmutex_init(nmutex_t* m){
+    InitializeCriticalSection(m);
+}
+inline void nmutex_lock(nmutex_t* m){
+    EnterCriticalSection(m);
+}
+inline void nmutex_unlock(nmutex_t* m){
+    LeaveCriticalSection(m);
+}
+inline void nmutex_destroy(nmutex_t* m){
+    DeleteCriticalSection(m);
+}
+
 #else
 #include <pthread.h>
 #include <unistd.h>
@@ -60,4 +77,24 @@ inline unsigned nthread_get_processors_num(){
     return sysconf(_SC_NPROCESSORS_ONLN);
 }
 
+typedef pthread_mutex_t nmutex_t;
+
+inline void nmutex_init(nmutex_t* m){
+    pthread_mutex_init(m, NULL);
+}
+inline void nmutex_lock(nmutex_t* m){
+    pthread_mutex_lock(m);
+}
+inline void nmutex_unlock(nmutex_t* m){
+    pthread_mutex_unlock(m);
+}
+inline void nmutex_destroy(nmutex_t* m){
+    pthread_mutex_destroy(m);
+}
+
 #endif
+
+// Thread function calling a std::function (userdata)
+inline THREAD_FUNC_BEGIN(call_in_thread)
+    (*reinterpret_cast<std::function<void()>*>(userdata))();
+THREAD_FUNC_END
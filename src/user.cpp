@@ -40,16 +40,118 @@ ssb_renderer ssb_create_renderer_from_memory(int width, int height, char format,
     }
 }
 
+int ssb_add_script(ssb_renderer renderer, const char* script, char* warning){
+    if(renderer)
+        try{
+            std::string script_string = script;
+            reinterpret_cast<Renderer*>(renderer)->add_script(script_string, warning != 0);
+            return 1;
+        }catch(std::string err){
+            if(warning)
+                warning[err.copy(warning, SSB_WARNING_LENGTH - 1)] = '\0';
+        }
+    return 0;
+}
+
+int ssb_add_script_from_memory(ssb_renderer renderer, const char* data, char* warning){
+    if(renderer)
+        try{
+            std::istringstream data_stream(data);
+            reinterpret_cast<Renderer*>(renderer)->add_script(data_stream, warning != 0);
+            return 1;
+        }catch(std::string err){
+            if(warning)
+                warning[err.copy(warning, SSB_WARNING_LENGTH - 1)] = '\0';
+        }
+    return 0;
+}
+
 void ssb_set_target(ssb_renderer renderer, int width, int height, char format){
     if(renderer)
         reinterpret_cast<Renderer*>(renderer)->set_target(width, height, format == SSB_BGR ? Renderer::Colorspace::BGR : (format == SSB_BGRX ? Renderer::Colorspace::BGRX : Renderer::Colorspace::BGRA));
 }
 
+void ssb_set_subpixel_phases(ssb_renderer renderer, int phases){
+    if(renderer)
+        reinterpret_cast<Renderer*>(renderer)->set_subpixel_phases(phases);
+}
+
+void ssb_set_dot_phases(ssb_renderer renderer, int phases){
+    if(renderer)
+        reinterpret_cast<Renderer*>(renderer)->set_dot_phases(phases);
+}
+
+void ssb_set_scanline_rasterizer(ssb_renderer renderer, int enable){
+    if(renderer)
+        reinterpret_cast<Renderer*>(renderer)->set_scanline_rasterizer(enable);
+}
+
+void ssb_set_texture_cache_budget(unsigned long int bytes){
+    CairoImage::set_file_cache_budget(bytes);
+}
+
+void ssb_set_frame_grid(ssb_renderer renderer, unsigned long int fps_num, unsigned long int fps_den){
+    if(renderer)
+        reinterpret_cast<Renderer*>(renderer)->set_frame_grid(fps_num, fps_den);
+}
+
 void ssb_render(ssb_renderer renderer, unsigned char* image, int pitch, unsigned long int start_ms){
     if(renderer)
         reinterpret_cast<Renderer*>(renderer)->render(image, pitch, start_ms);
 }
 
+void ssb_render_region(ssb_renderer renderer, unsigned char* image, int pitch, unsigned long int start_ms, int x, int y, int width, int height){
+    if(renderer)
+        reinterpret_cast<Renderer*>(renderer)->render_region(image, pitch, start_ms, x, y, width, height);
+}
+
+void ssb_render_multi(ssb_renderer renderer, const ssb_target* targets, int targets_n, unsigned long int start_ms){
+    if(renderer && targets){
+        std::vector<Renderer::Target> renderer_targets;
+        for(int i = 0; i < targets_n; ++i)
+            renderer_targets.push_back({targets[i].image, targets[i].pitch, targets[i].width, targets[i].height,
+                                        targets[i].format == SSB_BGR ? Renderer::Colorspace::BGR : (targets[i].format == SSB_BGRX ? Renderer::Colorspace::BGRX : Renderer::Colorspace::BGRA)});
+        reinterpret_cast<Renderer*>(renderer)->render_multi(renderer_targets, start_ms);
+    }
+}
+
+const ssb_rect* ssb_get_dirty_rects(ssb_renderer renderer, int* rects_n){
+    if(renderer){
+        const std::vector<Renderer::Rect>& rects = reinterpret_cast<Renderer*>(renderer)->get_dirty_rects();
+        if(rects_n)
+            *rects_n = rects.size();
+        return rects.empty() ? 0 : reinterpret_cast<const ssb_rect*>(rects.data());
+    }
+    if(rects_n)
+        *rects_n = 0;
+    return 0;
+}
+
+unsigned long long int ssb_get_signature(ssb_renderer renderer, int* changed){
+    if(renderer){
+        bool renderer_changed;
+        unsigned long long int signature = reinterpret_cast<Renderer*>(renderer)->get_signature(&renderer_changed);
+        if(changed)
+            *changed = renderer_changed;
+        return signature;
+    }
+    if(changed)
+        *changed = 0;
+    return 0;
+}
+
+void ssb_get_stats(ssb_renderer renderer, ssb_stats* stats){
+    if(renderer && stats){
+        const Renderer::Stats renderer_stats = reinterpret_cast<Renderer*>(renderer)->get_stats();
+        stats->raster_lookups = renderer_stats.raster_lookups;
+        stats->raster_hits = renderer_stats.raster_hits;
+        stats->texture_lookups = renderer_stats.texture_lookups;
+        stats->texture_hits = renderer_stats.texture_hits;
+        stats->texture_decodes = renderer_stats.texture_decodes;
+        stats->texture_decode_ms = renderer_stats.texture_decode_ms;
+    }
+}
+
 void ssb_free_renderer(ssb_renderer renderer){
     if(renderer)
         delete reinterpret_cast<Renderer*>(renderer);
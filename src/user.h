@@ -37,6 +37,25 @@ typedef void* ssb_renderer;
 /// Frame colorspaces
 enum {SSB_BGR = 0, SSB_BGRX, SSB_BGRA};
 
+/// Frame area (origin at top-left)
+typedef struct{
+    int x, y, width, height;
+} ssb_rect;
+
+/// Frame to render on (data + meta informations)
+typedef struct{
+    unsigned char* image;
+    int pitch, width, height;
+    char format;
+} ssb_target;
+
+/// Cache statistics (dedup ratio = raster_hits / raster_lookups; texture values count for all renderers)
+typedef struct{
+    unsigned long int raster_lookups, raster_hits;
+    unsigned long int texture_lookups, texture_hits, texture_decodes;
+    double texture_decode_ms;
+} ssb_stats;
+
 /// Maximal length for output warning of ssb_create_renderer and ssb_create_renderer_from_memory
 #define SSB_WARNING_LENGTH 256
 
@@ -64,6 +83,26 @@ Create renderer handle from memory.
 */
 DLL_EXPORT ssb_renderer ssb_create_renderer_from_memory(int width, int height, char format, const char* data, char* warning);
 
+/**
+Add script from file on top of the previous ones (rendered in one pass with them).
+
+@param renderer Renderer handle
+@param script SSB script to render
+@param warning Output warning, pointer can be zero
+@return 1 on success, 0 on failure
+*/
+DLL_EXPORT int ssb_add_script(ssb_renderer renderer, const char* script, char* warning);
+
+/**
+Add script from memory on top of the previous ones (rendered in one pass with them).
+
+@param renderer Renderer handle
+@param data SSB data to render (null-terminated string)
+@param warning Output warning, pointer can be zero
+@return 1 on success, 0 on failure
+*/
+DLL_EXPORT int ssb_add_script_from_memory(ssb_renderer renderer, const char* data, char* warning);
+
 /**
 Set target frame information.
 
@@ -74,6 +113,47 @@ Set target frame information.
 */
 DLL_EXPORT void ssb_set_target(ssb_renderer renderer, int width, int height, char format);
 
+/**
+Set number of subpixel phases per axis for rasters of translation animations (4 by default, 0 disables reuse).
+
+@param renderer Renderer handle
+@param phases Phases number (more: better positioning, less: more reuse)
+*/
+DLL_EXPORT void ssb_set_subpixel_phases(ssb_renderer renderer, int phases);
+
+/**
+Set number of subpixel phases per axis for stamped dot sprites of points geometries (16 by default, 0 fills dots as path).
+Dots apart get stamped, edge coverage differs from filled dots by up to 255/phases + 4 levels; overlapping dots are always filled.
+
+@param renderer Renderer handle
+@param phases Phases number (more: less difference, less: more sprite reuse)
+*/
+DLL_EXPORT void ssb_set_dot_phases(ssb_renderer renderer, int phases);
+
+/**
+Set fill rasterizer: internal scanline rasterizer (analytic coverage) or cairo (default).
+
+@param renderer Renderer handle
+@param enable 1 for scanline rasterizer, 0 for cairo
+*/
+DLL_EXPORT void ssb_set_scanline_rasterizer(ssb_renderer renderer, int enable);
+
+/**
+Set memory limit of texture cache, shared by all renderers (default: 256 MB). The most recently used texture is always kept.
+
+@param bytes Maximal bytes of decoded textures and their mip levels
+*/
+DLL_EXPORT void ssb_set_texture_cache_budget(unsigned long int bytes);
+
+/**
+Set frame rate of host, render times get quantized to his frame grid and animation renderings get cached per frame (for hosts requesting frames repeatedly; off by default).
+
+@param renderer Renderer handle
+@param fps_num Frame rate numerator (0 = no quantization)
+@param fps_den Frame rate denominator
+*/
+DLL_EXPORT void ssb_set_frame_grid(ssb_renderer renderer, unsigned long int fps_num, unsigned long int fps_den);
+
 /**
 Render on image.
 
@@ -84,6 +164,56 @@ Render on image.
 */
 DLL_EXPORT void ssb_render(ssb_renderer renderer, unsigned char* image, int pitch, unsigned long int start_ms);
 
+/**
+Render on image region.
+
+@param renderer Renderer handle
+@param image Region data (same layout as frame data, but just region dimension)
+@param pitch Region row pitch
+@param start_ms Start time of frame in milliseconds
+@param x Region horizontal offset in frame
+@param y Region vertical offset in frame (from top)
+@param width Region width
+@param height Region height
+*/
+DLL_EXPORT void ssb_render_region(ssb_renderer renderer, unsigned char* image, int pitch, unsigned long int start_ms, int x, int y, int width, int height);
+
+/**
+Render on multiple images of any size (layout and paths get shared, feedback refers to first image).
+
+@param renderer Renderer handle
+@param targets Frames to render on
+@param targets_n Number of frames
+@param start_ms Start time of frames in milliseconds
+*/
+DLL_EXPORT void ssb_render_multi(ssb_renderer renderer, const ssb_target* targets, int targets_n, unsigned long int start_ms);
+
+/**
+Get frame areas modified by last render.
+
+@param renderer Renderer handle
+@param rects_n Output number of areas, pointer can be zero
+@return Areas (valid until next render or target change) or zero
+*/
+DLL_EXPORT const ssb_rect* ssb_get_dirty_rects(ssb_renderer renderer, int* rects_n);
+
+/**
+Get content signature of last render (by active events, their time segments, target size & first region, not by pixels; cached, composited & new drawn images blend the same bytes).
+
+@param renderer Renderer handle
+@param changed Output flag for content difference to the render before, pointer can be zero
+@return Signature
+*/
+DLL_EXPORT unsigned long long int ssb_get_signature(ssb_renderer renderer, int* changed);
+
+/**
+Get cache statistics since renderer creation (texture statistics since program start).
+
+@param renderer Renderer handle
+@param stats Output statistics
+*/
+DLL_EXPORT void ssb_get_stats(ssb_renderer renderer, ssb_stats* stats);
+
 /**
 Destroy renderer handle.
 
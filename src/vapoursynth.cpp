@@ -16,6 +16,7 @@ Permission is granted to anyone to use this software for any purpose, including
 #include "VapourSynth.h"
 #include "file_info.h"
 #include "Renderer.hpp"
+#include <algorithm>
 
 namespace VS{
     // Memory-safe wrapper for VS node reference
@@ -80,27 +81,181 @@ namespace VS{
     void VS_CC apply_filter(const VSMap* in, VSMap* out, void*, VSCore* core, const VSAPI* vsapi){
         // Get filter arguments
         VSNode2 clip(vsapi->propGetNode(in, "clip", 0, NULL), vsapi);
-        std::string script(vsapi->propGetData(in, "script", 0, NULL), vsapi->propGetDataSize(in, "script", 0, NULL));
+        std::vector<std::string> scripts;
+        for(int i = 0, scripts_n = vsapi->propNumElements(in, "script"); i < scripts_n; ++i)
+            scripts.push_back(std::string(vsapi->propGetData(in, "script", i, NULL), vsapi->propGetDataSize(in, "script", i, NULL)));
         bool warnings = vsapi->propGetType(in, "warnings") == ptUnset ? true : vsapi->propGetInt(in, "warnings", 0, NULL);
+        bool frame_cache = vsapi->propGetType(in, "frame_cache") == ptUnset ? false : vsapi->propGetInt(in, "frame_cache", 0, NULL);
         // Check filter arguments
         const VSVideoInfo* info = clip.info();
         if(info->width < 1 || info->height < 1) // Clip must have a video stream
             vsapi->setError(out, "Video required!");
         else if(info->format->id != pfRGB24 && info->format->id != pfCompatBGR32)    // Video must store colors in RGB24 or RGB32 format
             vsapi->setError(out, "Video colorspace must be RGB24 or RGB32!");
-        else if(script.empty()) // Empty script name not acceptable
+        else if(scripts.empty() || std::any_of(scripts.begin(), scripts.end(), [](std::string& script){return script.empty();}))  // Empty script name not acceptable
             vsapi->setError(out, "Script name required!");
         else{
-            // Allocate renderer
-            Renderer* renderer;
+            // Allocate renderer (scripts stacked in given order)
+            Renderer* renderer = nullptr;
             try{
-                renderer = new Renderer(info->width, info->height, info->format->id == pfRGB24 ? Renderer::Colorspace::BGR : Renderer::Colorspace::BGRA, script, warnings);
+                renderer = new Renderer(info->width, info->height, info->format->id == pfRGB24 ? Renderer::Colorspace::BGR : Renderer::Colorspace::BGRA, scripts.front(), warnings);
+                for(auto script = scripts.begin() + 1; script != scripts.end(); ++script)
+                    renderer->add_script(*script, warnings);
+                if(frame_cache)
+                    renderer->set_frame_grid(info->fpsNum, info->fpsDen);
             }catch(std::string err){
+                delete renderer;
                 vsapi->setError(out, err.c_str());
                 return;
             }
-            // Create new filter to Vapoursynth API
-            vsapi->createFilter(in, out, FILTER_NAME, init_filter, get_frame, free_filter, fmParallel, 0, new FilterData{{vsapi->cloneNodeRef(clip), vsapi}, renderer}, core);
+            // Create new filter to Vapoursynth API (stateful renderer -> one request at a time)
+            vsapi->createFilter(in, out, FILTER_NAME, init_filter, get_frame, free_filter, fmUnordered, 0, new FilterData{{vsapi->cloneNodeRef(clip), vsapi}, renderer}, core);
+        }
+    }
+
+    // Layer filter data to pass through filter callbacks
+    struct LayerFilterData{
+        // Output video informations (color + alpha) + frame rate source
+        VSVideoInfo infos[2];
+        Renderer* renderer;
+        // Layer buffer (BGRA, premultiplied, stored bottom-up) + his frame number
+        std::vector<unsigned char> layer;
+        int layer_n;
+        // Shared frames for blank output (color + alpha)
+        const VSFrameRef* blank_frames[2];
+    };
+
+    // Layer frame processing
+    const VSFrameRef* VS_CC get_layer_frame(int n, int activationReason, void** inst_data, void**, VSFrameContext* frame_ctx, VSCore* core, const VSAPI* vsapi){
+        LayerFilterData* data = reinterpret_cast<LayerFilterData*>(*inst_data);
+        // Frame creation (no input frames needed)
+        if(activationReason == arInitial){
+            const int width = data->infos[0].width, height = data->infos[0].height, layer_stride = width << 2;
+            // Render layer (once per frame number, both outputs share it)
+            if(n != data->layer_n){
+                // Clear areas drawn by last render
+                for(const Renderer::Rect& rect : data->renderer->get_dirty_rects())
+                    for(int y = rect.y; y < rect.y + rect.height; ++y)
+                        std::fill_n(data->layer.begin() + (height - 1 - y) * layer_stride + (rect.x << 2), rect.width << 2, 0);
+                data->renderer->render(data->layer.data(), layer_stride, n * (data->infos[0].fpsDen * 1000.0 / data->infos[0].fpsNum));
+                data->layer_n = n;
+            }
+            // Nothing rendered -> return shared blank frame
+            const int output = vsapi->getOutputIndex(frame_ctx);
+            if(data->renderer->get_dirty_rects().empty())
+                return vsapi->cloneFrameRef(data->blank_frames[output]);
+            // Create new frame from layer
+            VSFrameRef* dst = vsapi->newVideoFrame(data->infos[output].format, width, height, NULL, core);
+            if(output == 0){
+                if(data->infos[0].format->id == pfCompatBGR32){
+                    // Copy rows (both stored bottom-up)
+                    unsigned char* dst_data = vsapi->getWritePtr(dst, 0);
+                    const int dst_stride = vsapi->getStride(dst, 0);
+                    for(int y = 0; y < height; ++y)
+                        std::copy_n(data->layer.begin() + y * layer_stride, layer_stride, dst_data + y * dst_stride);
+                }else{  // format == pfRGB24
+                    // Split colors into planes (stored top-down)
+                    unsigned char* dst_planes[3] = {vsapi->getWritePtr(dst, 0), vsapi->getWritePtr(dst, 1), vsapi->getWritePtr(dst, 2)};
+                    const int dst_strides[3] = {vsapi->getStride(dst, 0), vsapi->getStride(dst, 1), vsapi->getStride(dst, 2)};
+                    for(int y = 0; y < height; ++y){
+                        const unsigned char* layer_row = data->layer.data() + (height - 1 - y) * layer_stride;
+                        unsigned char* r_row = dst_planes[0] + y * dst_strides[0],
+                            *g_row = dst_planes[1] + y * dst_strides[1],
+                            *b_row = dst_planes[2] + y * dst_strides[2];
+                        for(int x = 0; x < width; ++x){
+                            b_row[x] = layer_row[0];
+                            g_row[x] = layer_row[1];
+                            r_row[x] = layer_row[2];
+                            layer_row += 4;
+                        }
+                    }
+                }
+            }else{  // output == 1
+                // Extract alpha (stored top-down)
+                unsigned char* dst_data = vsapi->getWritePtr(dst, 0);
+                const int dst_stride = vsapi->getStride(dst, 0);
+                for(int y = 0; y < height; ++y){
+                    const unsigned char* layer_row = data->layer.data() + (height - 1 - y) * layer_stride + 3;
+                    unsigned char* dst_row = dst_data + y * dst_stride;
+                    for(int x = 0; x < width; ++x){
+                        dst_row[x] = *layer_row;
+                        layer_row += 4;
+                    }
+                }
+            }
+            // Return new frame
+            return dst;
+        }
+        return NULL;
+    }
+
+    // Layer filter initialization / set output video infomations
+    void VS_CC init_layer_filter(VSMap*, VSMap*, void** inst_data, VSNode* node, VSCore*, const VSAPI* vsapi){
+        vsapi->setVideoInfo(reinterpret_cast<LayerFilterData*>(*inst_data)->infos, 2, node);
+    }
+
+    // Layer filter destruction
+    void VS_CC free_layer_filter(void* inst_data, VSCore*, const VSAPI* vsapi){
+        LayerFilterData* data = reinterpret_cast<LayerFilterData*>(inst_data);
+        // Free data from filter creation
+        vsapi->freeFrame(data->blank_frames[0]);
+        vsapi->freeFrame(data->blank_frames[1]);
+        delete data->renderer;
+        delete data;
+    }
+
+    // Layer filter creation
+    void VS_CC apply_layer_filter(const VSMap* in, VSMap* out, void*, VSCore* core, const VSAPI* vsapi){
+        // Get filter arguments
+        VSNode2 clip(vsapi->propGetNode(in, "clip", 0, NULL), vsapi);
+        std::vector<std::string> scripts;
+        for(int i = 0, scripts_n = vsapi->propNumElements(in, "script"); i < scripts_n; ++i)
+            scripts.push_back(std::string(vsapi->propGetData(in, "script", i, NULL), vsapi->propGetDataSize(in, "script", i, NULL)));
+        const VSVideoInfo* info = clip.info();
+        int width = vsapi->propGetType(in, "width") == ptUnset ? info->width : vsapi->propGetInt(in, "width", 0, NULL);
+        int height = vsapi->propGetType(in, "height") == ptUnset ? info->height : vsapi->propGetInt(in, "height", 0, NULL);
+        int format = vsapi->propGetType(in, "format") == ptUnset ? static_cast<int>(pfCompatBGR32) : vsapi->propGetInt(in, "format", 0, NULL);
+        bool warnings = vsapi->propGetType(in, "warnings") == ptUnset ? true : vsapi->propGetInt(in, "warnings", 0, NULL);
+        bool frame_cache = vsapi->propGetType(in, "frame_cache") == ptUnset ? false : vsapi->propGetInt(in, "frame_cache", 0, NULL);
+        // Check filter arguments
+        if(info->numFrames < 1 || info->fpsNum < 1 || info->fpsDen < 1)    // Clip must have a constant frame rate and length
+            vsapi->setError(out, "Clip with constant frame rate and length required!");
+        else if(width < 1 || height < 1)    // Layer needs a size
+            vsapi->setError(out, "Width and height must be positive!");
+        else if(format != pfRGB24 && format != pfCompatBGR32)   // Layer must store colors in RGB24 or RGB32 format
+            vsapi->setError(out, "Format must be RGB24 or RGB32!");
+        else if(scripts.empty() || std::any_of(scripts.begin(), scripts.end(), [](std::string& script){return script.empty();}))  // Empty script name not acceptable
+            vsapi->setError(out, "Script name required!");
+        else{
+            // Allocate renderer (scripts stacked in given order)
+            Renderer* renderer = nullptr;
+            try{
+                renderer = new Renderer(width, height, Renderer::Colorspace::BGRA, scripts.front(), warnings);
+                for(auto script = scripts.begin() + 1; script != scripts.end(); ++script)
+                    renderer->add_script(*script, warnings);
+                if(frame_cache)
+                    renderer->set_frame_grid(info->fpsNum, info->fpsDen);
+            }catch(std::string err){
+                delete renderer;
+                vsapi->setError(out, err.c_str());
+                return;
+            }
+            // Set output video informations (color + alpha with clip timing)
+            LayerFilterData* data = new LayerFilterData{{*info, *info}, renderer, std::vector<unsigned char>(width * height << 2, 0), -1, {}};
+            for(VSVideoInfo& output_info : data->infos)
+                output_info.width = width,
+                output_info.height = height;
+            data->infos[0].format = vsapi->getFormatPreset(format, core);
+            data->infos[1].format = vsapi->getFormatPreset(pfGray8, core);
+            // Create shared blank frames
+            for(int output = 0; output < 2; ++output){
+                VSFrameRef* blank = vsapi->newVideoFrame(data->infos[output].format, width, height, NULL, core);
+                for(int plane = 0; plane < data->infos[output].format->numPlanes; ++plane)
+                    std::fill_n(vsapi->getWritePtr(blank, plane), vsapi->getStride(blank, plane) * vsapi->getFrameHeight(blank, plane), 0);
+                data->blank_frames[output] = blank;
+            }
+            // Create new filter to Vapoursynth API (stateful renderer -> one request at a time)
+            vsapi->createFilter(in, out, "SSBLayer", init_layer_filter, get_layer_frame, free_layer_filter, fmUnordered, 0, data, core);
         }
     }
 }
@@ -110,5 +265,6 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit(VSConfigPlugin config_func, VSRegist
     // Write filter information to Vapoursynth configuration (identifier, namespace, description, vs version, is read-only, plugin storage)
     config_func("com.subtitle.ssb", "ssb", FILTER_DESCRIPTION, VAPOURSYNTH_API_VERSION, 1, plugin);
     // Register filter to Vapoursynth with configuration in plugin storage (filter name, arguments, filter creation function, userdata, plugin storage)
-    reg_func(FILTER_NAME, "clip:clip;script:data;warnings:int:opt", VS::apply_filter, 0, plugin);
+    reg_func(FILTER_NAME, "clip:clip;script:data[];warnings:int:opt;frame_cache:int:opt", VS::apply_filter, 0, plugin);
+    reg_func("SSBLayer", "clip:clip;script:data[];width:int:opt;height:int:opt;format:int:opt;warnings:int:opt;frame_cache:int:opt", VS::apply_layer_filter, 0, plugin);
 }
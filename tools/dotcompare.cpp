@@ -0,0 +1,104 @@
+/*
+Project: SSBRenderer
+File: dotcompare.cpp
+
+Copyright (c) 2013, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+
+    The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    This notice may not be removed or altered from any source distribution.
+*/
+
+// Tolerance check of stamped dot sprites against filled dots.
+// Usage: dotcompare [-p PHASES] [-t TOLERANCE]
+// Renders generated point scripts (dots apart & overlapping, various sizes and subpixel offsets) with sprites and without,
+// fails (exit code 1) if any channel differs by more than the tolerance (default: 255 / phases + 4 levels).
+
+#include "../src/user.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+namespace{
+    // Frame size
+    const int width = 640, height = 480;
+    // Script with grid of dots (spacing in dot sizes, subpixel offsets cycled over the grid)
+    std::string dots_script(double dot_size, double spacing){
+        std::ostringstream script;
+        script << "#EVENTS\n0-1.0|||{pos=0,0;an=7;gm=pt;lw=" << dot_size << '}';
+        const double step = dot_size * spacing + 0.37;
+        int n = 0;
+        for(double y = dot_size + 1; y < height - dot_size - 1; y += step)
+            for(double x = dot_size + 1; x < width - dot_size - 1; x += step, ++n)
+                script << x + (n % 7) / 7.0 << ' ' << y + (n % 5) / 5.0 << ' ';
+        return script.str();
+    }
+    // Render script with given dot phases (false on failure)
+    bool render_script(const std::string& script, int phases, std::vector<unsigned char>& frame){
+        char warning[SSB_WARNING_LENGTH];
+        ssb_renderer renderer = ssb_create_renderer_from_memory(width, height, SSB_BGRA, script.c_str(), warning);
+        if(!renderer){
+            std::fprintf(stderr, "%s\n", warning);
+            return false;
+        }
+        ssb_set_dot_phases(renderer, phases);
+        std::fill(frame.begin(), frame.end(), 0);
+        ssb_render(renderer, frame.data(), width << 2, 0);
+        ssb_free_renderer(renderer);
+        return true;
+    }
+}
+
+int main(int argc, char** argv){
+    // Parse options
+    int phases = 16, tolerance = -1;
+    for(int i = 1; i < argc; ++i)
+        if(i + 1 < argc && !std::strcmp(argv[i], "-p"))
+            phases = std::atoi(argv[++i]);
+        else if(i + 1 < argc && !std::strcmp(argv[i], "-t"))
+            tolerance = std::atoi(argv[++i]);
+        else{
+            std::fprintf(stderr, "Usage: %s [-p PHASES] [-t TOLERANCE]\n", argv[0]);
+            return 1;
+        }
+    if(phases <= 0){
+        std::fprintf(stderr, "Phases have to be positive\n");
+        return 1;
+    }
+    if(tolerance < 0)
+        tolerance = 255 / phases + 4;
+    // Compare sprites against filled dots per dot size & spacing
+    const double dot_sizes[] = {1, 1.5, 2.5, 4, 7.3, 12, 25.6}, spacings[] = {3, 1.5, 0.6};
+    std::vector<unsigned char> frame_filled(width * height << 2), frame_sprites(frame_filled.size());
+    std::printf("%10s %8s %8s %10s\n", "dot size", "spacing", "max diff", "pixels > 1");
+    int total_max_diff = 0;
+    for(double dot_size : dot_sizes)
+        for(double spacing : spacings){
+            const std::string script = dots_script(dot_size, spacing);
+            if(!render_script(script, 0, frame_filled) || !render_script(script, phases, frame_sprites))
+                return 1;
+            int max_diff = 0;
+            unsigned long int diff_pixels = 0;
+            for(size_t i = 0; i < frame_filled.size(); i += 4){
+                int pixel_diff = 0;
+                for(size_t c = i; c < i + 4; ++c)
+                    pixel_diff = std::max(pixel_diff, std::abs(frame_filled[c] - frame_sprites[c]));
+                max_diff = std::max(max_diff, pixel_diff);
+                if(pixel_diff > 1)
+                    ++diff_pixels;
+            }
+            std::printf("%10.2f %8.2f %8d %10lu\n", dot_size, spacing, max_diff, diff_pixels);
+            total_max_diff = std::max(total_max_diff, max_diff);
+        }
+    const bool passed = total_max_diff <= tolerance;
+    std::printf("max diff %d, tolerance %d (%d phases): %s\n", total_max_diff, tolerance, phases, passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+/*
+Project: SSBRenderer
+File: rastercompare.cpp
+
+Copyright (c) 2013, Christoph "Youka" Spanknebel
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+
+    The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+    Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+    This notice may not be removed or altered from any source distribution.
+*/
+
+// Benchmark & image difference of fill rasterizers: internal scanline rasterizer against cairo.
+// Usage: rastercompare [-w WIDTH] [-h HEIGHT] [-s STEP_MS] [-e END_MS] SCRIPT...
+// Every sampled frame gets rendered by a new renderer per rasterizer (no cache reuse between frames), so times cover first renderings.
+// No reference results are recorded yet: run it on the targeted scripts before enabling the scanline rasterizer.
+
+#include "../src/user.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+namespace{
+    // Render frame with new renderer, return milliseconds (negative on failure)
+    double render_frame(const char* script, int width, int height, bool scanline, unsigned long int ms, std::vector<unsigned char>& frame){
+        char warning[SSB_WARNING_LENGTH];
+        ssb_renderer renderer = ssb_create_renderer(width, height, SSB_BGRA, script, warning);
+        if(!renderer){
+            std::fprintf(stderr, "%s: %s\n", script, warning);
+            return -1;
+        }
+        ssb_set_scanline_rasterizer(renderer, scanline);
+        std::fill(frame.begin(), frame.end(), 0);
+        const auto start = std::chrono::steady_clock::now();
+        ssb_render(renderer, frame.data(), width << 2, ms);
+        const double elapsed = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count();
+        ssb_free_renderer(renderer);
+        return elapsed;
+    }
+}
+
+int main(int argc, char** argv){
+    // Parse options
+    int width = 1280, height = 720;
+    unsigned long int step_ms = 500, end_ms = 10000;
+    std::vector<const char*> scripts;
+    for(int i = 1; i < argc; ++i)
+        if(i + 1 < argc && !std::strcmp(argv[i], "-w"))
+            width = std::atoi(argv[++i]);
+        else if(i + 1 < argc && !std::strcmp(argv[i], "-h"))
+            height = std::atoi(argv[++i]);
+        else if(i + 1 < argc && !std::strcmp(argv[i], "-s"))
+            step_ms = std::max(std::atol(argv[++i]), 1L);
+        else if(i + 1 < argc && !std::strcmp(argv[i], "-e"))
+            end_ms = std::atol(argv[++i]);
+        else
+            scripts.push_back(argv[i]);
+    if(scripts.empty() || width <= 0 || height <= 0){
+        std::fprintf(stderr, "Usage: %s [-w WIDTH] [-h HEIGHT] [-s STEP_MS] [-e END_MS] SCRIPT...\n", argv[0]);
+        return 1;
+    }
+    // Compare rasterizers per script
+    std::vector<unsigned char> frame_cairo(width * height << 2), frame_scanline(frame_cairo.size());
+    std::printf("%-32s %6s %12s %12s %8s %8s %10s %12s\n", "script", "frames", "cairo ms", "scanline ms", "speedup", "max diff", "mean diff", "pixels > 1");
+    double total_cairo = 0, total_scanline = 0;
+    int total_max_diff = 0;
+    for(const char* script : scripts){
+        double time_cairo = 0, time_scanline = 0, diff_sum = 0;
+        int max_diff = 0, frames = 0;
+        unsigned long int diff_pixels = 0;
+        for(unsigned long int ms = 0; ms < end_ms; ms += step_ms){
+            const double ms_cairo = render_frame(script, width, height, false, ms, frame_cairo),
+                ms_scanline = render_frame(script, width, height, true, ms, frame_scanline);
+            if(ms_cairo < 0 || ms_scanline < 0)
+                break;
+            time_cairo += ms_cairo,
+            time_scanline += ms_scanline;
+            ++frames;
+            // Channel differences (pixel counts if any channel differs by more than 1)
+            for(size_t i = 0; i < frame_cairo.size(); i += 4){
+                int pixel_diff = 0;
+                for(size_t c = i; c < i + 4; ++c){
+                    const int diff = std::abs(frame_cairo[c] - frame_scanline[c]);
+                    diff_sum += diff;
+                    pixel_diff = std::max(pixel_diff, diff);
+                }
+                max_diff = std::max(max_diff, pixel_diff);
+                if(pixel_diff > 1)
+                    ++diff_pixels;
+            }
+        }
+        if(!frames)
+            continue;
+        std::printf("%-32s %6d %12.2f %12.2f %8.2f %8d %10.4f %12lu\n", script, frames, time_cairo, time_scanline,
+                    time_cairo / std::max(time_scanline, 1e-9), max_diff, diff_sum / (static_cast<double>(frame_cairo.size()) * frames), diff_pixels);
+        total_cairo += time_cairo,
+        total_scanline += time_scanline;
+        total_max_diff = std::max(total_max_diff, max_diff);
+    }
+    std::printf("%-32s %6s %12.2f %12.2f %8.2f %8d\n", "total", "", total_cairo, total_scanline, total_cairo / std::max(total_scanline, 1e-9), total_max_diff);
+    return 0;
+}